@@ -0,0 +1,199 @@
+/**
+ * @file adjust.c
+ * @date 16 Oct 2026
+ * @brief Brightness and contrast adjustments.
+ *
+ * Every component v of a region is replaced by floor(v*gain) + offset, saturated to 0..255,
+ * with gain in 8.8 fixed point. Rows of the region being contiguous in pix1d, they are
+ * processed as flat arrays of bytes, 32 at a time with AVX2 or 16 at a time with SSE2,
+ * in bands of rows spread over the default thread pool (see parallel.h).
+ */
+
+#include <stdlib.h>
+#include "adjust.h"
+#include "parallel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86
+#endif
+
+// Fixed point gain equal to 1
+#define GAIN_ONE 256
+
+typedef struct {
+    unsigned int gain;      // 8.8 fixed point, 0 to 65535
+    int offset;             // -255 to 255
+} adjust_t;
+
+// Rectangle processed by adjust_band
+typedef struct {
+    img_t *img;
+    int x, width;
+    adjust_t adj;
+} adjust_rect_t;
+
+static adjust_t make_adjust(float gain, int offset);
+static void adjust_band(void *arg, int first, int last);
+static void adjust_row(uint8_t *data, size_t count, adjust_t adj);
+static void adjust_scalar(uint8_t *data, size_t count, adjust_t adj);
+#ifdef HAVE_X86
+static size_t adjust_sse2(uint8_t *data, size_t count, adjust_t adj);
+static size_t adjust_avx2(uint8_t *data, size_t count, adjust_t adj);
+#endif
+
+/**
+ * Scale and offset the brightness of a rectangle of an image: each component v becomes
+ * v*gain + offset, rounded down and saturated to 0..255.
+ * @param img a pointer to the image to modify
+ * @param x the left coordinate of the rectangle
+ * @param y the top coordinate of the rectangle
+ * @param width the width of the rectangle
+ * @param height the height of the rectangle
+ * @param gain the factor applied to the components (0 to 256, with a precision of 1/256)
+ * @param offset the value added to the components after scaling (-255 to 255)
+ * @return false if the rectangle doesn't fit within the image, true otherwise
+ */
+bool adjust_brightness(img_t *img, int x, int y, int width, int height, float gain, int offset) {
+    if (x < 0 || y < 0 || width < 0 || height < 0 ||
+        x > img->width - width || y > img->height - height) return false;
+
+    adjust_rect_t rect = { img, x, width, make_adjust(gain, offset) };
+    parallel_for(default_pool(), y, y + height, band_grain(sizeof(pixel_t) * width), adjust_band, &rect);
+    return true;
+}
+
+/**
+ * Change the contrast and brightness of a rectangle of an image: the components are
+ * scaled by contrast around the middle value (128), then brightness is added.
+ * @param img a pointer to the image to modify
+ * @param x the left coordinate of the rectangle
+ * @param y the top coordinate of the rectangle
+ * @param width the width of the rectangle
+ * @param height the height of the rectangle
+ * @param contrast the contrast factor (1 keeps the contrast unchanged, 0 to 2)
+ * @param brightness the value added to the components (-127 to 127)
+ * @return false if the rectangle doesn't fit within the image, true otherwise
+ */
+bool adjust_contrast(img_t *img, int x, int y, int width, int height, float contrast, int brightness) {
+    int offset = 128 + brightness - (int)(128 * contrast + 0.5f);
+    return adjust_brightness(img, x, y, width, height, contrast, offset);
+}
+
+/**
+ * Fill a table mapping each component v to v*gain + offset, rounded down and saturated
+ * to 0..255, exactly as adjust_brightness does.
+ * @param lut the table to fill
+ * @param gain the factor applied to the components (0 to 256, with a precision of 1/256)
+ * @param offset the value added to the components after scaling (-255 to 255)
+ */
+void make_adjust_lut(uint8_t lut[256], float gain, int offset) {
+    for (int v = 0; v < 256; v++)
+        lut[v] = v;
+    adjust_scalar(lut, 256, make_adjust(gain, offset));
+}
+
+/**
+ * Scale and offset an array of components: each component v becomes v*gain + offset,
+ * rounded down and saturated to 0..255.
+ * @param data the components to modify
+ * @param count the number of components
+ * @param gain the factor applied to the components (0 to 256, with a precision of 1/256)
+ * @param offset the value added to the components after scaling (-255 to 255)
+ */
+void scale_offset(uint8_t *data, size_t count, float gain, int offset) {
+    adjust_row(data, count, make_adjust(gain, offset));
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Convert the parameters to fixed point, clamped to their valid ranges.
+static adjust_t make_adjust(float gain, int offset) {
+    adjust_t adj;
+    float g = gain * GAIN_ONE + 0.5f;
+    adj.gain = g <= 0 ? 0 : g >= 65535 ? 65535 : (unsigned int)g;
+    adj.offset = offset < -255 ? -255 : offset > 255 ? 255 : offset;
+    return adj;
+}
+
+static void adjust_band(void *arg, int first, int last) {
+    adjust_rect_t *rect = arg;
+    for (int j = first; j < last; j++)
+        adjust_row((uint8_t *)(rect->img->pix2d[j] + rect->x), (size_t)3 * rect->width, rect->adj);
+}
+
+static void adjust_row(uint8_t *data, size_t count, adjust_t adj) {
+    size_t i = 0;
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("avx2"))
+        i = adjust_avx2(data, count, adj);
+    else
+        i = adjust_sse2(data, count, adj);
+#endif
+    adjust_scalar(data + i, count - i, adj);
+}
+
+static void adjust_scalar(uint8_t *data, size_t count, adjust_t adj) {
+    for (size_t i = 0; i < count; i++) {
+        int v = (int)((data[i] * adj.gain) >> 8) + adj.offset;
+        data[i] = v < 0 ? 0 : v > 255 ? 255 : v;
+    }
+}
+
+#ifdef HAVE_X86
+// The components are widened to 16 bits as v*256 (the component in the high byte), so that
+// the high half of the product with the gain is floor(v*gain/256). The product is then
+// capped to 510, the offset added (positive part) and subtracted (negative part) with
+// unsigned saturation, and the result packed back to bytes with saturation to 255.
+
+// Adjust 16 components at a time. Return the number of components processed.
+__attribute__((target("sse2")))
+static size_t adjust_sse2(uint8_t *data, size_t count, adjust_t adj) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i gain = _mm_set1_epi16((short)adj.gain);
+    const __m128i cap = _mm_set1_epi16(510);
+    const __m128i add = _mm_set1_epi16(adj.offset > 0 ? adj.offset : 0);
+    const __m128i sub = _mm_set1_epi16(adj.offset < 0 ? -adj.offset : 0);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i *p = (__m128i *)(data + i);
+        __m128i v = _mm_loadu_si128(p);
+        __m128i lo = _mm_mulhi_epu16(_mm_unpacklo_epi8(zero, v), gain);
+        __m128i hi = _mm_mulhi_epu16(_mm_unpackhi_epi8(zero, v), gain);
+        // min(x, 510) = x - max(x - 510, 0)
+        lo = _mm_sub_epi16(lo, _mm_subs_epu16(lo, cap));
+        hi = _mm_sub_epi16(hi, _mm_subs_epu16(hi, cap));
+        lo = _mm_subs_epu16(_mm_adds_epu16(lo, add), sub);
+        hi = _mm_subs_epu16(_mm_adds_epu16(hi, add), sub);
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+// Adjust 32 components at a time. Return the number of components processed.
+__attribute__((target("avx2")))
+static size_t adjust_avx2(uint8_t *data, size_t count, adjust_t adj) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i gain = _mm256_set1_epi16((short)adj.gain);
+    const __m256i cap = _mm256_set1_epi16(510);
+    const __m256i add = _mm256_set1_epi16(adj.offset > 0 ? adj.offset : 0);
+    const __m256i sub = _mm256_set1_epi16(adj.offset < 0 ? -adj.offset : 0);
+    size_t i = 0;
+    // Unpacking and packing both work within 128-bit lanes, so the order is preserved
+    for (; i + 32 <= count; i += 32) {
+        __m256i *p = (__m256i *)(data + i);
+        __m256i v = _mm256_loadu_si256(p);
+        __m256i lo = _mm256_mulhi_epu16(_mm256_unpacklo_epi8(zero, v), gain);
+        __m256i hi = _mm256_mulhi_epu16(_mm256_unpackhi_epi8(zero, v), gain);
+        lo = _mm256_min_epu16(lo, cap);
+        hi = _mm256_min_epu16(hi, cap);
+        lo = _mm256_subs_epu16(_mm256_adds_epu16(lo, add), sub);
+        hi = _mm256_subs_epu16(_mm256_adds_epu16(hi, add), sub);
+        _mm256_storeu_si256(p, _mm256_packus_epi16(lo, hi));
+    }
+    // Remaining full vectors of 16 components
+    return i + adjust_sse2(data + i, count - i, adj);
+}
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file adjust.h
+ * @date 16 Oct 2026
+ * @brief Brightness and contrast adjustments.
+ */
+
+#ifndef ADJUST_H
+#define ADJUST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppm.h"
+
+extern bool adjust_brightness(img_t *img, int x, int y, int width, int height, float gain, int offset);
+extern bool adjust_contrast(img_t *img, int x, int y, int width, int height, float contrast, int brightness);
+extern void make_adjust_lut(uint8_t lut[256], float gain, int offset);
+extern void scale_offset(uint8_t *data, size_t count, float gain, int offset);
+
+#endif
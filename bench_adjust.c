@@ -0,0 +1,98 @@
+/**
+ * @file bench_adjust.c
+ * @date 16 Oct 2026
+ * @brief Benchmark of adjust_brightness against the scalar loop it replaced in ppm_example.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <libgen.h>
+#include <time.h>
+#include "ppm.h"
+#include "adjust.h"
+
+#define RUNS 10
+
+/**
+ * Return the current time in seconds.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Halve the brightness of the whole image, one component at a time over pix2d.
+ * @param img the image to modify
+ */
+static void halve_loop(img_t *img) {
+    for (int j = 0; j < img->height; j++) {
+        for (int i = 0; i < img->width; i++) {
+            pixel_t *p = &img->pix2d[j][i];
+            p->r /= 2;
+            p->g /= 2;
+            p->b /= 2;
+        }
+    }
+}
+
+/**
+ * Halve the brightness of the whole image with adjust_brightness.
+ * @param img the image to modify
+ */
+static void halve_kernel(img_t *img) {
+    adjust_brightness(img, 0, 0, img->width, img->height, 0.5f, 0);
+}
+
+/**
+ * Time the best of RUNS executions of a routine on an image, refilled before each run.
+ * @param img the image to use
+ * @param halve the routine to time
+ * @return the best time in seconds
+ */
+static double time_halve(img_t *img, void (*halve)(img_t *)) {
+    double best = -1;
+    for (int run = 0; run < RUNS; run++) {
+        for (int i = 0; i < img->width * img->height; i++) {
+            pixel_t p = { i, i >> 8, i >> 16 };
+            img->pix1d[i] = p;
+        }
+        double start = now();
+        halve(img);
+        double t = now() - start;
+        if (best < 0 || t < best) best = t;
+    }
+    return best;
+}
+
+/**
+ * Program entry point.
+ * @param argc command line argument count
+ * @param argv program's command line arguments
+ */
+int main(int argc, char **argv) {
+    if (argc != 1 && argc != 3) {
+        fprintf(stderr, "usage: %s [width height]\n", basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+    int width = argc == 3 ? atoi(argv[1]) : 4096;
+    int height = argc == 3 ? atoi(argv[2]) : 4096;
+
+    img_t *img = alloc_img(width, height);
+    if (!img) {
+        fprintf(stderr, "Failed allocating a %dx%d image!\n", width, height);
+        return EXIT_FAILURE;
+    }
+
+    double mb = sizeof(pixel_t) * (double)width * height / (1024 * 1024);
+    printf("%dx%d image (%.0f MB), best of %d runs\n", width, height, mb, RUNS);
+
+    double t = time_halve(img, halve_loop);
+    printf("scalar loop        %8.4f s %8.1f MB/s\n", t, mb / t);
+    t = time_halve(img, halve_kernel);
+    printf("adjust_brightness  %8.4f s %8.1f MB/s\n", t, mb / t);
+
+    free_img(img);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file bench_blur.c
+ * @date 16 Oct 2026
+ * @brief Benchmark of gaussian_blur and box_gaussian_blur across sigmas and image sizes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppm.h"
+#include "blur.h"
+#include "parallel.h"
+
+#define RUNS 3
+
+/**
+ * Return the current time in seconds.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Time the best of RUNS blurs of an image.
+ * @param img the image to blur (in place)
+ * @param sigma the standard deviation of the Gaussian
+ * @param box whether to use box_gaussian_blur (3 passes) rather than gaussian_blur
+ * @return the best time in seconds, or -1 if a blur failed
+ */
+static double time_blur(img_t *img, float sigma, bool box) {
+    double best = -1;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now();
+        bool ok = box ? box_gaussian_blur(img, img, sigma, 3, BORDER_CLAMP) :
+            gaussian_blur(img, img, sigma, BORDER_CLAMP);
+        double t = now() - start;
+        if (!ok) return -1;
+        if (best < 0 || t < best) best = t;
+    }
+    return best;
+}
+
+/**
+ * Program entry point.
+ */
+int main(void) {
+    const int sizes[] = { 512, 2048, 4096 };
+    const float sigmas[] = { 0.5f, 1, 2, 5, 10, 20 };
+
+    printf("%d threads, best of %d runs, Mpixels/s\n", pool_size(default_pool()), RUNS);
+    printf("size          ");
+    for (size_t s = 0; s < sizeof(sigmas) / sizeof(sigmas[0]); s++)
+        printf(" sigma %-4g", sigmas[s]);
+    printf("\n");
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        int size = sizes[i];
+        img_t *img = alloc_img(size, size);
+        if (!img) {
+            fprintf(stderr, "Failed allocating a %dx%d image!\n", size, size);
+            return EXIT_FAILURE;
+        }
+        for (int p = 0; p < size * size; p++) {
+            pixel_t px = { p, p >> 8, p >> 16 };
+            img->pix1d[p] = px;
+        }
+
+        for (int box = 0; box <= 1; box++) {
+            printf("%-5d %-8s", size, box ? "box x3" : "gaussian");
+            for (size_t s = 0; s < sizeof(sigmas) / sizeof(sigmas[0]); s++) {
+                double t = time_blur(img, sigmas[s], box);
+                if (t < 0) {
+                    fprintf(stderr, "Failed blurring!\n");
+                    free_img(img);
+                    return EXIT_FAILURE;
+                }
+                printf(" %10.1f", (double)size * size / t / 1e6);
+                fflush(stdout);
+            }
+            printf("\n");
+        }
+        free_img(img);
+    }
+    return EXIT_SUCCESS;
+}
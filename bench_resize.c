@@ -0,0 +1,158 @@
+/**
+ * @file bench_resize.c
+ * @date 16 Oct 2026
+ * @brief Benchmark of resize against a naive per-pixel resampling, for each filter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "ppm.h"
+#include "resize.h"
+#include "parallel.h"
+
+#define RUNS 3
+
+// Size of the source image
+#define SRC_SIZE 2048
+
+/**
+ * Return the current time in seconds.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Value of a filter at distance x from its center, as in resize.c.
+ */
+static double filter_weight(enum RESIZE_FILTER filter, double x) {
+    const double a = -0.5;
+    x = fabs(x);
+    switch (filter) {
+    case RESIZE_BICUBIC:
+        if (x < 1) return ((a + 2) * x - (a + 3)) * x * x + 1;
+        if (x < 2) return ((x - 5) * x + 8) * x * a - 4 * a;
+        return 0;
+    case RESIZE_LANCZOS:
+        if (x == 0) return 1;
+        if (x < 3) return 3 * sin(M_PI * x) * sin(M_PI * x / 3) / (M_PI * M_PI * x * x);
+        return 0;
+    default:
+        return x < 1 ? 1 - x : 0;
+    }
+}
+
+/**
+ * Naive resampling: each output pixel sums its 2D window of source pixels, computing the
+ * weights on the fly.
+ * @param src the image to resample
+ * @param dst the image receiving the result
+ * @param filter the resampling filter
+ */
+static void naive_resize(img_t *src, img_t *dst, enum RESIZE_FILTER filter) {
+    double radius = filter == RESIZE_LANCZOS ? 3 : filter == RESIZE_BICUBIC ? 2 : 1;
+    double sx = (double)src->width / dst->width, sy = (double)src->height / dst->height;
+    double stretch_x = sx > 1 ? sx : 1, stretch_y = sy > 1 ? sy : 1;
+
+    for (int j = 0; j < dst->height; j++) {
+        double cy = (j + 0.5) * sy;
+        int y0 = (int)floor(cy - radius * stretch_y), y1 = (int)ceil(cy + radius * stretch_y);
+        for (int i = 0; i < dst->width; i++) {
+            double cx = (i + 0.5) * sx;
+            int x0 = (int)floor(cx - radius * stretch_x), x1 = (int)ceil(cx + radius * stretch_x);
+            double sum[3] = { 0, 0, 0 }, total = 0;
+            for (int y = y0 < 0 ? 0 : y0; y < y1 && y < src->height; y++) {
+                double wy = filter_weight(filter, (y + 0.5 - cy) / stretch_y);
+                for (int x = x0 < 0 ? 0 : x0; x < x1 && x < src->width; x++) {
+                    double w = wy * filter_weight(filter, (x + 0.5 - cx) / stretch_x);
+                    pixel_t p = src->pix2d[y][x];
+                    sum[0] += w * p.r;
+                    sum[1] += w * p.g;
+                    sum[2] += w * p.b;
+                    total += w;
+                }
+            }
+            uint8_t c[3];
+            for (int k = 0; k < 3; k++) {
+                double v = round(sum[k] / total);
+                c[k] = v < 0 ? 0 : v > 255 ? 255 : v;
+            }
+            pixel_t p = { c[0], c[1], c[2] };
+            dst->pix2d[j][i] = p;
+        }
+    }
+}
+
+/**
+ * Time the best of runs resamplings of an image.
+ * @param src the image to resample
+ * @param dst the image receiving the result
+ * @param filter the resampling filter
+ * @param naive whether to use naive_resize rather than resize
+ * @param runs the number of runs
+ * @return the best time in seconds, or -1 if a resampling failed
+ */
+static double time_resize(img_t *src, img_t *dst, enum RESIZE_FILTER filter, bool naive, int runs) {
+    double best = -1;
+    for (int run = 0; run < runs; run++) {
+        double start = now();
+        bool ok = true;
+        if (naive) naive_resize(src, dst, filter);
+        else ok = resize(src, dst, filter);
+        double t = now() - start;
+        if (!ok) return -1;
+        if (best < 0 || t < best) best = t;
+    }
+    return best;
+}
+
+/**
+ * Program entry point.
+ */
+int main(void) {
+    const int sizes[] = { 4096, 3000, 1024, 1000, 512 };
+    const char *names[] = { "bilinear", "bicubic", "lanczos" };
+
+    img_t *src = alloc_img(SRC_SIZE, SRC_SIZE);
+    if (!src) {
+        fprintf(stderr, "Failed allocating a %dx%d image!\n", SRC_SIZE, SRC_SIZE);
+        return EXIT_FAILURE;
+    }
+    for (int p = 0; p < SRC_SIZE * SRC_SIZE; p++) {
+        pixel_t px = { p, p >> 8, p >> 16 };
+        src->pix1d[p] = px;
+    }
+
+    printf("%d threads, %dx%d source, output Mpixels/s (naive: 1 run, resize: best of %d)\n",
+           pool_size(default_pool()), SRC_SIZE, SRC_SIZE, RUNS);
+    printf("target    filter       naive     resize   speedup\n");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        int size = sizes[i];
+        img_t *dst = alloc_img(size, size);
+        if (!dst) {
+            fprintf(stderr, "Failed allocating a %dx%d image!\n", size, size);
+            free_img(src);
+            return EXIT_FAILURE;
+        }
+        for (int f = RESIZE_BILINEAR; f <= RESIZE_LANCZOS; f++) {
+            double naive = time_resize(src, dst, f, true, 1);
+            double fast = time_resize(src, dst, f, false, RUNS);
+            if (fast < 0) {
+                fprintf(stderr, "Failed resizing!\n");
+                free_img(dst);
+                free_img(src);
+                return EXIT_FAILURE;
+            }
+            double mpixels = (double)size * size / 1e6;
+            printf("%-9d %-9s %8.2f %10.1f %8.1fx\n", size, names[f], mpixels / naive, mpixels / fast, naive / fast);
+            fflush(stdout);
+        }
+        free_img(dst);
+    }
+    free_img(src);
+    return EXIT_SUCCESS;
+}
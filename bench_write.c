@@ -0,0 +1,107 @@
+/**
+ * @file bench_write.c
+ * @date 16 Oct 2026
+ * @brief Benchmark of write_ppm against write_ppm_parallel across thread counts.
+ *
+ * Each measurement includes an fsync of the written file, so that the storage bandwidth
+ * is measured rather than the page cache's.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <libgen.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ppm.h"
+
+#define RUNS 3
+
+/**
+ * Return the current time in seconds.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Flush a file to disk.
+ * @param filename the file to flush
+ */
+static void sync_file(char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * Time the best of RUNS writes of an image.
+ * @param filename the file to write
+ * @param img the image to write
+ * @param nthreads the number of threads, or 0 to use write_ppm
+ * @return the best time in seconds, or -1 if a write failed
+ */
+static double time_write(char *filename, img_t *img, int nthreads) {
+    double best = -1;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now();
+        bool ok = nthreads == 0 ? write_ppm(filename, img, PPM_RAW) :
+            write_ppm_parallel(filename, img, nthreads);
+        sync_file(filename);
+        double t = now() - start;
+        if (!ok) return -1;
+        if (best < 0 || t < best) best = t;
+    }
+    return best;
+}
+
+/**
+ * Program entry point.
+ * @param argc command line argument count
+ * @param argv program's command line arguments
+ */
+int main(int argc, char **argv) {
+    if (argc != 2 && argc != 4) {
+        fprintf(stderr, "usage: %s output [width height]\n", basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+    char *output = argv[1];
+    int width = argc == 4 ? atoi(argv[2]) : 8192;
+    int height = argc == 4 ? atoi(argv[3]) : 8192;
+
+    img_t *img = alloc_img(width, height);
+    if (!img) {
+        fprintf(stderr, "Failed allocating a %dx%d image!\n", width, height);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < width * height; i++) {
+        pixel_t p = { i, i >> 8, i >> 16 };
+        img->pix1d[i] = p;
+    }
+
+    double mb = sizeof(pixel_t) * (double)width * height / (1024 * 1024);
+    printf("%dx%d image (%.0f MB), best of %d runs\n", width, height, mb, RUNS);
+
+    double t = time_write(output, img, 0);
+    if (t < 0) goto error;
+    printf("write_ppm              %8.3f s %8.1f MB/s\n", t, mb / t);
+
+    for (int nthreads = 1; nthreads <= 16; nthreads *= 2) {
+        t = time_write(output, img, nthreads);
+        if (t < 0) goto error;
+        printf("write_ppm_parallel %2d  %8.3f s %8.1f MB/s\n", nthreads, t, mb / t);
+    }
+
+    unlink(output);
+    free_img(img);
+    return EXIT_SUCCESS;
+
+error:
+    fprintf(stderr, "Failed writing \"%s\"!\n", output);
+    free_img(img);
+    return EXIT_FAILURE;
+}
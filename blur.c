@@ -0,0 +1,439 @@
+/**
+ * @file blur.c
+ * @date 16 Oct 2026
+ * @brief Blur filters.
+ *
+ * The Gaussian blur is separable: a horizontal 1D convolution followed by a vertical one
+ * costs 2*(2r+1) operations per component instead of (2r+1)^2 for the 2D kernel.
+ *
+ * Both passes are computed in 16-bit fixed point, 8 components at a time with SSE2.
+ * Components are scaled by 256 (8 fractional bits) and the weights by 65536, so that the
+ * high half of their product (mulhi) is the weighted component, still scaled by 256. The
+ * horizontal pass keeps these 8 fractional bits in an intermediate image, which the
+ * vertical pass reads and rounds back to 8 bits. Since all components of a row use the
+ * same weights, the horizontal pass treats the interleaved components of a row as a flat
+ * array, the taps of a pixel being 3 components apart.
+ *
+ * The vertical pass runs down strips of columns narrow enough for the rows of a strip
+ * covered by the kernel to stay in the L2 cache, whatever the width of the image. Both
+ * passes are spread over the default thread pool by bands of rows (see parallel.h).
+ *
+ * The box blur costs the same whatever its radius: each pass slides a window along the
+ * rows (then the columns), adding the component entering it and subtracting the one
+ * leaving it. The horizontal pass runs the 3 channels of a row side by side; the vertical
+ * pass keeps one sum per component of a strip of columns, updated with SSE2 one row at
+ * a time, and runs the strips in parallel. The horizontal pass keeps its sums unrounded
+ * in a 32-bit intermediate image, so that the average of the (2r+1)^2 components is only
+ * rounded once, in the vertical pass. Averages are computed in double precision, exact
+ * for the sums of boxes up to MAX_BOX_RADIUS. Iterating box blurs of well chosen sizes
+ * approximates a Gaussian blur in constant time.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "blur.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Bytes of the intermediate rows covered by the kernel in a strip of the vertical pass
+#define STRIP_BYTES (128 * 1024)
+
+// Number of components of a strip of the box blur's vertical pass
+#define BOX_STRIP 256
+
+// Largest radius of the box blur, for which the sums of a box fit in 31 bits
+#define MAX_BOX_RADIUS 1024
+
+// 1D convolution kernel, of 2*radius+1 taps
+typedef struct {
+    int radius;
+    int ntaps;
+    uint16_t *weights;  // scaled by 65536 (summing up to it)
+} kernel1d_t;
+
+// Arguments of the passes
+typedef struct {
+    img_t *src, *dst;
+    uint16_t *tmp;      // intermediate image: 3*width components per row, scaled by 256
+    kernel1d_t *kernel;
+    enum BORDER_MODE border;
+    const uint16_t *zero;   // a row of 0 components (BORDER_ZERO only)
+    int strip;          // number of components of the strips of the vertical pass
+    atomic_bool failed; // whether an allocation failed
+} blur_t;
+
+// Arguments of the passes of the box blur
+typedef struct {
+    img_t *src, *dst;
+    uint32_t *tmp;      // result of the horizontal pass: 3*width sums per row
+    int radius;
+    enum BORDER_MODE border;
+} box_t;
+
+static bool make_gaussian(kernel1d_t *kernel, float sigma);
+static void box_pass(box_t *box);
+static void box_horizontal_band(void *arg, int first, int last);
+static void box_vertical_strips(void *arg, int first, int last);
+static void horizontal_band(void *arg, int first, int last);
+static void vertical_band(void *arg, int first, int last);
+static void convolve16(const uint16_t **taps, const kernel1d_t *kernel, size_t count, uint16_t *out);
+static void convolve8(const uint16_t **taps, const kernel1d_t *kernel, size_t count, uint8_t *out);
+
+/**
+ * Blur an image with a Gaussian kernel.
+ * @param src a pointer to the image to blur
+ * @param dst a pointer to the image receiving the result, of the same size; it may be src
+ * @param sigma the standard deviation of the Gaussian, in pixels (0 copies the image)
+ * @param border how pixels outside of the image are made up
+ * @return false if the sizes of the images differ or an allocation failed, true otherwise
+ */
+bool gaussian_blur(img_t *src, img_t *dst, float sigma, enum BORDER_MODE border) {
+    if (src->width != dst->width || src->height != dst->height) return false;
+    if (src->width == 0 || src->height == 0) return true;
+    if (sigma <= 0) {
+        if (dst != src) memcpy(dst->pix1d, src->pix1d, sizeof(pixel_t) * src->width * src->height);
+        return true;
+    }
+
+    kernel1d_t kernel;
+    if (!make_gaussian(&kernel, sigma)) return false;
+
+    size_t row_length = (size_t)3 * src->width;
+    blur_t blur = { src, dst, NULL, &kernel, border, NULL, 0, false };
+    blur.tmp = malloc(sizeof(uint16_t) * row_length * src->height);
+    if (border == BORDER_ZERO) blur.zero = calloc(row_length, sizeof(uint16_t));
+    if (!blur.tmp || (border == BORDER_ZERO && !blur.zero)) {
+        atomic_store(&blur.failed, true);
+        goto out;
+    }
+    size_t strip = STRIP_BYTES / (sizeof(uint16_t) * kernel.ntaps) / 8 * 8;
+    blur.strip = strip < 8 ? 8 : strip > row_length ? row_length : strip;
+
+    // The vertical pass only reads the intermediate image, so dst may be src
+    parallel_for(default_pool(), 0, src->height, band_grain(sizeof(uint16_t) * row_length),
+                 horizontal_band, &blur);
+    if (!atomic_load(&blur.failed))
+        parallel_for(default_pool(), 0, src->height, band_grain(sizeof(uint16_t) * blur.strip * kernel.ntaps),
+                     vertical_band, &blur);
+
+out:
+    free((void *)blur.zero);
+    free(blur.tmp);
+    free(kernel.weights);
+    return !atomic_load(&blur.failed);
+}
+
+/**
+ * Blur an image with a box filter: each component becomes the average of the components
+ * of the (2*radius+1)^2 square centered on it. The cost doesn't depend on the radius.
+ * @param src a pointer to the image to blur
+ * @param dst a pointer to the image receiving the result, of the same size; it may be src
+ * @param radius the radius of the box, in pixels (0 copies the image), at most MAX_BOX_RADIUS
+ * @param border how pixels outside of the image are made up
+ * @return false if the sizes of the images differ, the radius is too large or an
+ *         allocation failed, true otherwise
+ */
+bool box_blur(img_t *src, img_t *dst, int radius, enum BORDER_MODE border) {
+    if (src->width != dst->width || src->height != dst->height) return false;
+    if (radius > MAX_BOX_RADIUS) return false;
+    // One more pixel, so that empty images get an allocation too
+    uint32_t *tmp = malloc(sizeof(uint32_t) * 3 * ((size_t)src->width * src->height + 1));
+    if (!tmp) return false;
+
+    box_t box = { src, dst, tmp, radius < 0 ? 0 : radius, border };
+    box_pass(&box);
+    free(tmp);
+    return true;
+}
+
+/**
+ * Blur an image with successive box filters approximating a Gaussian kernel.
+ * The cost doesn't depend on sigma; 3 passes are within a few percent of the Gaussian.
+ * @param src a pointer to the image to blur
+ * @param dst a pointer to the image receiving the result, of the same size; it may be src
+ * @param sigma the standard deviation of the Gaussian, in pixels
+ * @param passes the number of box filters (at least 1)
+ * @param border how pixels outside of the image are made up
+ * @return false if the sizes of the images differ, sigma needs boxes larger than
+ *         MAX_BOX_RADIUS or an allocation failed, true otherwise
+ */
+bool box_gaussian_blur(img_t *src, img_t *dst, float sigma, int passes, enum BORDER_MODE border) {
+    if (src->width != dst->width || src->height != dst->height) return false;
+    if (passes < 1) passes = 1;
+
+    // Boxes of widths wl (odd) then wl+2, whose variances ((w^2-1)/12 each) add up to sigma^2
+    double var = 12.0 * sigma * sigma;
+    int wl = (int)floor(sqrt(var / passes + 1));
+    if (wl % 2 == 0) wl--;
+    int m = (int)lround((var - passes * wl * wl - 4.0 * passes * wl - 3 * passes) / (-4.0 * wl - 4));
+    if ((wl + 1) / 2 > MAX_BOX_RADIUS) return false;
+
+    // One more pixel, so that empty images get an allocation too
+    uint32_t *tmp = malloc(sizeof(uint32_t) * 3 * ((size_t)src->width * src->height + 1));
+    if (!tmp) return false;
+
+    box_t box = { src, dst, tmp, 0, border };
+    for (int i = 0; i < passes; i++) {
+        box.radius = ((i < m ? wl : wl + 2) - 1) / 2;
+        box_pass(&box);
+        box.src = dst;
+    }
+    free(tmp);
+    return true;
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Compute the weights of a Gaussian kernel of radius ceil(3*sigma).
+static bool make_gaussian(kernel1d_t *kernel, float sigma) {
+    kernel->radius = (int)ceilf(3 * sigma);
+    kernel->ntaps = 2 * kernel->radius + 1;
+    kernel->weights = malloc(sizeof(uint16_t) * kernel->ntaps);
+    double *g = malloc(sizeof(double) * kernel->ntaps);
+    if (!kernel->weights || !g) {
+        free(kernel->weights);
+        free(g);
+        kernel->weights = NULL;
+        return false;
+    }
+
+    double sum = 0;
+    for (int k = 0; k < kernel->ntaps; k++) {
+        int d = k - kernel->radius;
+        g[k] = exp(-d * d / (2.0 * sigma * sigma));
+        sum += g[k];
+    }
+    // Round the weights and give the rounding error to the center one, so that they sum
+    // up to 65536 (up to 65535 for a center weight of 1: the sum then loses 1/65536)
+    long total = 0;
+    for (int k = 0; k < kernel->ntaps; k++) {
+        double w = g[k] / sum * 65536;
+        kernel->weights[k] = w > 65535 ? 65535 : lround(w);
+        total += kernel->weights[k];
+    }
+    long center = kernel->weights[kernel->radius] + 65536 - total;
+    kernel->weights[kernel->radius] = center > 65535 ? 65535 : center;
+    free(g);
+    return true;
+}
+
+// Horizontal pass of rows [first, last[, from the source image to the intermediate one.
+static void horizontal_band(void *arg, int first, int last) {
+    blur_t *blur = arg;
+    img_t *src = blur->src;
+    int radius = blur->kernel->radius;
+    size_t row_length = (size_t)3 * src->width;
+    // Row extended with radius pixels on each side, scaled by 256
+    uint16_t *buf = malloc(sizeof(uint16_t) * 3 * (src->width + 2*radius));
+    const uint16_t **taps = malloc(sizeof(uint16_t *) * blur->kernel->ntaps);
+    if (!buf || !taps) {
+        atomic_store(&blur->failed, true);
+        goto out;
+    }
+    for (int k = 0; k < blur->kernel->ntaps; k++)
+        taps[k] = buf + 3*k;
+
+    for (int j = first; j < last; j++) {
+        const pixel_t *row = src->pix2d[j];
+        for (int i = -radius; i < src->width + radius; i++) {
+            int x = border_index(i, src->width, blur->border);
+            uint16_t *p = buf + 3 * (i + radius);
+            p[0] = x < 0 ? 0 : row[x].r << 8;
+            p[1] = x < 0 ? 0 : row[x].g << 8;
+            p[2] = x < 0 ? 0 : row[x].b << 8;
+        }
+        convolve16(taps, blur->kernel, row_length, blur->tmp + row_length * j);
+    }
+
+out:
+    free(taps);
+    free(buf);
+}
+
+// Vertical pass of rows [first, last[, from the intermediate image to the destination one,
+// strip by strip.
+static void vertical_band(void *arg, int first, int last) {
+    blur_t *blur = arg;
+    int height = blur->src->height;
+    int radius = blur->kernel->radius;
+    size_t row_length = (size_t)3 * blur->src->width;
+    const uint16_t **taps = malloc(sizeof(uint16_t *) * blur->kernel->ntaps);
+    if (!taps) {
+        atomic_store(&blur->failed, true);
+        return;
+    }
+
+    for (size_t start = 0; start < row_length; start += blur->strip) {
+        size_t count = row_length - start < (size_t)blur->strip ? row_length - start : (size_t)blur->strip;
+        for (int j = first; j < last; j++) {
+            for (int k = 0; k < blur->kernel->ntaps; k++) {
+                int y = border_index(j + k - radius, height, blur->border);
+                taps[k] = (y < 0 ? blur->zero : blur->tmp + row_length * y) + start;
+            }
+            convolve8(taps, blur->kernel, count, (uint8_t *)blur->dst->pix2d[j] + start);
+        }
+    }
+    free(taps);
+}
+
+#ifdef __SSE2__
+// Weighted sum of the taps of components [i, i+8[, scaled by 256. Each product loses its
+// fractional part: the sum starts at ntaps/2 to compensate for it on average.
+static inline __m128i convolve_vec(const uint16_t **taps, const kernel1d_t *kernel, size_t i) {
+    __m128i acc = _mm_set1_epi16(kernel->ntaps / 2);
+    for (int k = 0; k < kernel->ntaps; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(taps[k] + i));
+        acc = _mm_adds_epu16(acc, _mm_mulhi_epu16(v, _mm_set1_epi16(kernel->weights[k])));
+    }
+    return acc;
+}
+#endif
+
+// Same as convolve_vec, for a single component.
+static inline unsigned int convolve_one(const uint16_t **taps, const kernel1d_t *kernel, size_t i) {
+    unsigned int acc = kernel->ntaps / 2;
+    for (int k = 0; k < kernel->ntaps; k++)
+        acc += (taps[k][i] * kernel->weights[k]) >> 16;
+    return acc > 65535 ? 65535 : acc;
+}
+
+// Convolve count components, keeping the result scaled by 256.
+static void convolve16(const uint16_t **taps, const kernel1d_t *kernel, size_t count, uint16_t *out) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8)
+        _mm_storeu_si128((__m128i *)(out + i), convolve_vec(taps, kernel, i));
+#endif
+    for (; i < count; i++)
+        out[i] = convolve_one(taps, kernel, i);
+}
+
+// Convolve count components, rounding the result to 8 bits.
+static void convolve8(const uint16_t **taps, const kernel1d_t *kernel, size_t count, uint8_t *out) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i half = _mm_set1_epi16(128);
+    for (; i + 16 <= count; i += 16) {
+        __m128i lo = _mm_srli_epi16(_mm_adds_epu16(convolve_vec(taps, kernel, i), half), 8);
+        __m128i hi = _mm_srli_epi16(_mm_adds_epu16(convolve_vec(taps, kernel, i + 8), half), 8);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        unsigned int v = (convolve_one(taps, kernel, i) + 128) >> 8;
+        out[i] = v > 255 ? 255 : v;
+    }
+}
+
+// Run the horizontal pass from src into tmp, then the vertical pass from tmp into dst.
+static void box_pass(box_t *box) {
+    int width = box->src->width, height = box->src->height;
+    if (width == 0 || height == 0) return;
+    parallel_for(default_pool(), 0, height, band_grain(sizeof(pixel_t) * width), box_horizontal_band, box);
+    int nstrips = (3 * width + BOX_STRIP - 1) / BOX_STRIP;
+    parallel_for(default_pool(), 0, nstrips, 1, box_vertical_strips, box);
+}
+
+// Horizontal pass of rows [first, last[, sliding a window of the 3 channels along each row
+// and storing its sums.
+static void box_horizontal_band(void *arg, int first, int last) {
+    box_t *box = arg;
+    int width = box->src->width, r = box->radius;
+
+    for (int j = first; j < last; j++) {
+        const pixel_t *row = box->src->pix2d[j];
+        uint32_t *out = box->tmp + (size_t)3 * width * j;
+        uint32_t sum[3] = { 0, 0, 0 };
+        for (int i = -r; i <= r; i++) {
+            int x = border_index(i, width, box->border);
+            if (x >= 0) {
+                sum[0] += row[x].r;
+                sum[1] += row[x].g;
+                sum[2] += row[x].b;
+            }
+        }
+        for (int i = 0; i < width; i++) {
+            out[3*i] = sum[0];
+            out[3*i + 1] = sum[1];
+            out[3*i + 2] = sum[2];
+            // The window leaves i-r and enters i+r+1; inside the image, no border lookup
+            int in = i + r + 1 < width ? i + r + 1 : border_index(i + r + 1, width, box->border);
+            int old = i - r >= 0 ? i - r : border_index(i - r, width, box->border);
+            if (in >= 0) {
+                sum[0] += row[in].r;
+                sum[1] += row[in].g;
+                sum[2] += row[in].b;
+            }
+            if (old >= 0) {
+                sum[0] -= row[old].r;
+                sum[1] -= row[old].g;
+                sum[2] -= row[old].b;
+            }
+        }
+    }
+}
+
+// Vertical pass of strips [first, last[ of BOX_STRIP components, each sliding a window
+// down all the rows and dividing its sums by the area of the box.
+static void box_vertical_strips(void *arg, int first, int last) {
+    box_t *box = arg;
+    int height = box->src->height, r = box->radius;
+    size_t row_length = (size_t)3 * box->src->width;
+    double scale = 1.0 / ((double)(2*r + 1) * (2*r + 1));
+    uint32_t sum[BOX_STRIP];
+
+    for (int s = first; s < last; s++) {
+        size_t start = (size_t)s * BOX_STRIP;
+        int count = row_length - start < BOX_STRIP ? row_length - start : BOX_STRIP;
+        for (int i = 0; i < count; i++) sum[i] = 0;
+        for (int k = -r; k <= r; k++) {
+            int y = border_index(k, height, box->border);
+            if (y < 0) continue;
+            const uint32_t *row = box->tmp + row_length * y + start;
+            for (int i = 0; i < count; i++) sum[i] += row[i];
+        }
+
+        for (int j = 0; j < height; j++) {
+            uint8_t *out = (uint8_t *)box->dst->pix2d[j] + start;
+            int in = j + r + 1 < height ? j + r + 1 : border_index(j + r + 1, height, box->border);
+            int old = j - r >= 0 ? j - r : border_index(j - r, height, box->border);
+            const uint32_t *add = in >= 0 ? box->tmp + row_length * in + start : NULL;
+            const uint32_t *sub = old >= 0 ? box->tmp + row_length * old + start : NULL;
+            int i = 0;
+#ifdef __SSE2__
+            const __m128i zero = _mm_setzero_si128();
+            const __m128d vscale = _mm_set1_pd(scale), half = _mm_set1_pd(0.5);
+            for (; i + 16 <= count; i += 16) {
+                __m128i avg[4];
+                for (int q = 0; q < 4; q++) {
+                    __m128i *p = (__m128i *)(sum + i + 4*q);
+                    __m128i s32 = _mm_loadu_si128(p);
+                    // Truncation of positive values rounds them, thanks to the added half
+                    __m128i lo = _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(s32), vscale), half));
+                    __m128i hi = _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(s32, 8)),
+                                                                        vscale), half));
+                    avg[q] = _mm_unpacklo_epi64(lo, hi);
+
+                    // Update the sums with the rows entering and leaving the window
+                    __m128i a = add ? _mm_loadu_si128((const __m128i *)(add + i + 4*q)) : zero;
+                    __m128i b = sub ? _mm_loadu_si128((const __m128i *)(sub + i + 4*q)) : zero;
+                    _mm_storeu_si128(p, _mm_add_epi32(s32, _mm_sub_epi32(a, b)));
+                }
+                _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(_mm_packs_epi32(avg[0], avg[1]),
+                                                                        _mm_packs_epi32(avg[2], avg[3])));
+            }
+#endif
+            for (; i < count; i++) {
+                out[i] = (uint8_t)(sum[i] * scale + 0.5);
+                sum[i] += (add ? add[i] : 0) - (sub ? sub[i] : 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,18 @@
+/**
+ * @file blur.h
+ * @date 16 Oct 2026
+ * @brief Blur filters.
+ */
+
+#ifndef BLUR_H
+#define BLUR_H
+
+#include <stdbool.h>
+#include "ppm.h"
+#include "tile.h"
+
+extern bool gaussian_blur(img_t *src, img_t *dst, float sigma, enum BORDER_MODE border);
+extern bool box_blur(img_t *src, img_t *dst, int radius, enum BORDER_MODE border);
+extern bool box_gaussian_blur(img_t *src, img_t *dst, float sigma, int passes, enum BORDER_MODE border);
+
+#endif
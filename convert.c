@@ -0,0 +1,423 @@
+/**
+ * @file convert.c
+ * @date 16 Oct 2026
+ * @brief Vectorized conversions between pixel formats.
+ *
+ * The routines operate on flat arrays of components, so that they apply to whole images
+ * (pix1d) as well as to single rows. SSE2 versions are used when available (always the
+ * case on x86-64), with a scalar implementation for the remaining elements and for other
+ * architectures. Routines needing byte shuffles have an SSSE3 version selected at runtime.
+ */
+
+#include <stdlib.h>
+#include "convert.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86
+#endif
+
+// Unsigned division by a constant d, exact for any dividend below 2^24: x/d == (x*mul) >> shift
+typedef struct {
+    uint32_t mul;
+    int shift;
+} divisor_t;
+
+// Unsigned division by a constant d, exact for any dividend below 2^16 (16-bit lanes):
+// t = (x*mul) >> 16, x/d == (t + ((x - t) >> shift1)) >> shift2
+typedef struct {
+    uint16_t mul;
+    int shift1, shift2;
+} divisor16_t;
+
+static divisor_t make_divisor(unsigned int d);
+static divisor16_t make_divisor16(unsigned int d);
+#ifdef HAVE_X86
+static size_t deinterleave3_ssse3(const uint8_t *src, uint8_t *c0, uint8_t *c1, uint8_t *c2, size_t count);
+static size_t interleave3_ssse3(const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, uint8_t *dst, size_t count);
+static size_t rgb_to_rgba_ssse3(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha);
+static size_t rgba_to_rgb_ssse3(const uint8_t *src, uint8_t *dst, size_t count);
+#endif
+
+/**
+ * Swap the bytes of 16-bit values in place (converts between big and little endian).
+ * @param data the values to swap
+ * @param count the number of values
+ */
+void swap_bytes16(uint16_t *data, size_t count) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((__m128i *)(data + i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *)(data + i), v);
+    }
+#endif
+    for (; i < count; i++)
+        data[i] = (uint16_t)(data[i] << 8 | data[i] >> 8);
+}
+
+/**
+ * Scale 16-bit components ranging from 0 to maxval to 8-bit components ranging from 0 to 255,
+ * rounding to the nearest value.
+ * @param src the components to scale
+ * @param dst the scaled components (may not overlap src)
+ * @param count the number of components
+ * @param maxval the maximum value of the source components (1 to 65535)
+ */
+void scale16to8(const uint16_t *src, uint8_t *dst, size_t count, unsigned int maxval) {
+    divisor_t div = make_divisor(maxval);
+    uint32_t half = maxval / 2;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mul = _mm_set1_epi32(div.mul);
+    const __m128i shift = _mm_cvtsi32_si128(div.shift);
+    const __m128i round = _mm_set1_epi32(half);
+    for (; i + 16 <= count; i += 16) {
+        __m128i words[2];
+        for (int k = 0; k < 2; k++) {
+            __m128i v = _mm_loadu_si128((__m128i *)(src + i + 8*k));
+            __m128i q[2];
+            for (int h = 0; h < 2; h++) {
+                __m128i x = h == 0 ? _mm_unpacklo_epi16(v, zero) : _mm_unpackhi_epi16(v, zero);
+                // x*255 + maxval/2, below 2^24
+                x = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(x, 8), x), round);
+                // Divide even and odd 32-bit lanes with 32x32->64 bit multiplies
+                __m128i even = _mm_srl_epi64(_mm_mul_epu32(x, mul), shift);
+                __m128i odd = _mm_srl_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), mul), shift);
+                q[h] = _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+            }
+            words[k] = _mm_packs_epi32(q[0], q[1]);
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(words[0], words[1]));
+    }
+#endif
+    for (; i < count; i++) {
+        uint32_t q = ((uint64_t)(src[i] * 255u + half) * div.mul) >> div.shift;
+        dst[i] = q > 255 ? 255 : q;
+    }
+}
+
+/**
+ * Compute the lookup table scaling 8-bit components from 0..from to 0..to, rounding to the
+ * nearest value. Values greater than from are mapped to to.
+ * @param lut the table to fill
+ * @param from the maximum value of the source components (1 to 255)
+ * @param to the maximum value of the scaled components (1 to 255)
+ */
+void make_scale_lut(uint8_t lut[256], unsigned int from, unsigned int to) {
+    for (unsigned int v = 0; v < 256; v++)
+        lut[v] = v > from ? to : (v * to + from / 2) / from;
+}
+
+/**
+ * Scale 8-bit components from 0..from to 0..to, rounding to the nearest value.
+ * Values greater than from are mapped to to. This computes the same function as the table
+ * built by make_scale_lut, with vector arithmetic for the bulk of the data.
+ * @param src the components to scale
+ * @param dst the scaled components (may be equal to src)
+ * @param count the number of components
+ * @param from the maximum value of the source components (1 to 255)
+ * @param to the maximum value of the scaled components (1 to 255)
+ */
+void scale8(const uint8_t *src, uint8_t *dst, size_t count, unsigned int from, unsigned int to) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    divisor16_t div = make_divisor16(from);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mul = _mm_set1_epi16(to);
+    const __m128i round = _mm_set1_epi16(from / 2);
+    const __m128i magic = _mm_set1_epi16(div.mul);
+    const __m128i shift1 = _mm_cvtsi32_si128(div.shift1);
+    const __m128i shift2 = _mm_cvtsi32_si128(div.shift2);
+    const __m128i maxval = _mm_set1_epi8(to);
+    const __m128i limit = _mm_set1_epi8(from);
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *)(src + i));
+        __m128i q[2];
+        for (int h = 0; h < 2; h++) {
+            __m128i x = h == 0 ? _mm_unpacklo_epi8(v, zero) : _mm_unpackhi_epi8(v, zero);
+            // x*to + from/2, below 2^16
+            x = _mm_add_epi16(_mm_mullo_epi16(x, mul), round);
+            __m128i t = _mm_mulhi_epu16(x, magic);
+            t = _mm_add_epi16(t, _mm_srl_epi16(_mm_sub_epi16(x, t), shift1));
+            q[h] = _mm_srl_epi16(t, shift2);
+        }
+        __m128i r = _mm_packus_epi16(q[0], q[1]);
+        // Values greater than from are mapped to to
+        __m128i over = _mm_cmpeq_epi8(_mm_max_epu8(v, limit), v);
+        over = _mm_andnot_si128(_mm_cmpeq_epi8(v, limit), over);
+        r = _mm_or_si128(_mm_and_si128(over, maxval), _mm_andnot_si128(over, r));
+        _mm_storeu_si128((__m128i *)(dst + i), r);
+    }
+#endif
+    if (i < count) {
+        uint8_t lut[256];
+        make_scale_lut(lut, from, to);
+        for (; i < count; i++)
+            dst[i] = lut[src[i]];
+    }
+}
+
+/**
+ * Split interleaved 3-component pixels (such as pixel_t) into 3 separate arrays.
+ * @param src the interleaved components (3*count bytes)
+ * @param c0 where to store the first component of each pixel (count bytes)
+ * @param c1 where to store the second component of each pixel (count bytes)
+ * @param c2 where to store the third component of each pixel (count bytes)
+ * @param count the number of pixels
+ */
+void deinterleave3(const uint8_t *src, uint8_t *c0, uint8_t *c1, uint8_t *c2, size_t count) {
+    size_t i = 0;
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("ssse3"))
+        i = deinterleave3_ssse3(src, c0, c1, c2, count);
+#endif
+    for (; i < count; i++) {
+        c0[i] = src[3*i];
+        c1[i] = src[3*i + 1];
+        c2[i] = src[3*i + 2];
+    }
+}
+
+/**
+ * Merge 3 separate arrays of components into interleaved 3-component pixels (such as pixel_t).
+ * @param c0 the first component of each pixel (count bytes)
+ * @param c1 the second component of each pixel (count bytes)
+ * @param c2 the third component of each pixel (count bytes)
+ * @param dst where to store the interleaved components (3*count bytes)
+ * @param count the number of pixels
+ */
+void interleave3(const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, uint8_t *dst, size_t count) {
+    size_t i = 0;
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("ssse3"))
+        i = interleave3_ssse3(c0, c1, c2, dst, count);
+#endif
+    for (; i < count; i++) {
+        dst[3*i] = c0[i];
+        dst[3*i + 1] = c1[i];
+        dst[3*i + 2] = c2[i];
+    }
+}
+
+/**
+ * Expand 3-byte RGB pixels (such as pixel_t) into 4-byte pixels (such as rgba_t).
+ * @param src the RGB pixels (3*count bytes)
+ * @param dst where to store the 4-byte pixels (4*count bytes), must not overlap src
+ * @param count the number of pixels
+ * @param alpha the value of the fourth byte of each pixel
+ */
+void rgb_to_rgba(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha) {
+    size_t i = 0;
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("ssse3"))
+        i = rgb_to_rgba_ssse3(src, dst, count, alpha);
+#endif
+    for (; i < count; i++) {
+        dst[4*i] = src[3*i];
+        dst[4*i + 1] = src[3*i + 1];
+        dst[4*i + 2] = src[3*i + 2];
+        dst[4*i + 3] = alpha;
+    }
+}
+
+/**
+ * Pack 4-byte pixels (such as rgba_t) into 3-byte RGB pixels (such as pixel_t), dropping
+ * the fourth byte.
+ * @param src the 4-byte pixels (4*count bytes)
+ * @param dst where to store the RGB pixels (3*count bytes), must not overlap src
+ * @param count the number of pixels
+ */
+void rgba_to_rgb(const uint8_t *src, uint8_t *dst, size_t count) {
+    size_t i = 0;
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("ssse3"))
+        i = rgba_to_rgb_ssse3(src, dst, count);
+#endif
+    for (; i < count; i++) {
+        dst[3*i] = src[4*i];
+        dst[3*i + 1] = src[4*i + 1];
+        dst[3*i + 2] = src[4*i + 2];
+    }
+}
+
+/**
+ * Convert a 48-bit image into a newly allocated 24-bit image, scaling the components
+ * from 0..maxval to 0..255.
+ * @param img a pointer to the image to convert
+ * @return a pointer to the converted image or NULL if the allocation failed
+ */
+img_t *img16_to_img(img16_t *img) {
+    img_t *dst = alloc_img(img->width, img->height);
+    if (!dst) return NULL;
+    scale16to8((uint16_t *)img->pix1d, (uint8_t *)dst->pix1d,
+        (size_t)3 * img->width * img->height, img->maxval);
+    return dst;
+}
+
+/**
+ * Convert a 24-bit image into a newly allocated 48-bit image with a maximum value of 65535.
+ * @param img a pointer to the image to convert
+ * @return a pointer to the converted image or NULL if the allocation failed
+ */
+img16_t *img_to_img16(img_t *img) {
+    img16_t *dst = alloc_img16(img->width, img->height, 65535);
+    if (!dst) return NULL;
+
+    const uint8_t *src = (uint8_t *)img->pix1d;
+    uint16_t *out = (uint16_t *)dst->pix1d;
+    size_t count = (size_t)3 * img->width * img->height;
+    for (size_t i = 0; i < count; i++)
+        out[i] = src[i] * 257;  // 255 -> 65535
+    return dst;
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Compute the parameters dividing by d (1 to 65535) any dividend below 2^16
+// (Granlund & Montgomery, figure 4.1).
+static divisor16_t make_divisor16(unsigned int d) {
+    int l = 0;
+    while ((1u << l) < d) l++;
+    divisor16_t div = {
+        (uint16_t)((((uint32_t)1 << 16) * ((1u << l) - d)) / d + 1),
+        l < 1 ? l : 1,
+        l > 1 ? l - 1 : 0
+    };
+    return div;
+}
+
+// Compute the multiplier and shift dividing by d (1 to 65535) any dividend below 2^24
+// (Granlund & Montgomery, "Division by invariant integers using multiplication").
+static divisor_t make_divisor(unsigned int d) {
+    int l = 0;
+    while ((1u << l) < d) l++;
+    divisor_t div = { (uint32_t)(((uint64_t)1 << (24 + l)) / d + 1), 24 + l };
+    return div;
+}
+
+#ifdef HAVE_X86
+// Shuffle masks gathering component k of 16 pixels from the 3 vectors (48 bytes) holding
+// them: SHUFFLE3[k][v] moves the bytes of vector v to their place, the others are zeroed.
+static const int8_t SHUFFLE3[3][3][16] = {
+    { { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 } },
+    { { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 } },
+    { { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 } }
+};
+
+// Inverse shuffle masks: UNSHUFFLE3[v][k] moves the bytes of component k to their place
+// in vector v of the interleaved pixels.
+static const int8_t UNSHUFFLE3[3][3][16] = {
+    { { 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+      { -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+      { -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 } },
+    { { -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+      { 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+      { -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 } },
+    { { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+      { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+      { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 } }
+};
+
+// Split 16 pixels at a time. Return the number of pixels processed.
+__attribute__((target("ssse3")))
+static size_t deinterleave3_ssse3(const uint8_t *src, uint8_t *c0, uint8_t *c1, uint8_t *c2, size_t count) {
+    uint8_t *dst[3] = { c0, c1, c2 };
+    __m128i mask[3][3];
+    for (int k = 0; k < 3; k++)
+        for (int v = 0; v < 3; v++)
+            mask[k][v] = _mm_loadu_si128((const __m128i *)SHUFFLE3[k][v]);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i in[3];
+        for (int v = 0; v < 3; v++)
+            in[v] = _mm_loadu_si128((const __m128i *)(src + 3*i + 16*v));
+        for (int k = 0; k < 3; k++) {
+            __m128i out = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(in[0], mask[k][0]),
+                _mm_shuffle_epi8(in[1], mask[k][1])), _mm_shuffle_epi8(in[2], mask[k][2]));
+            _mm_storeu_si128((__m128i *)(dst[k] + i), out);
+        }
+    }
+    return i;
+}
+
+// Merge 16 pixels at a time. Return the number of pixels processed.
+__attribute__((target("ssse3")))
+static size_t interleave3_ssse3(const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, uint8_t *dst, size_t count) {
+    const uint8_t *src[3] = { c0, c1, c2 };
+    __m128i mask[3][3];
+    for (int v = 0; v < 3; v++)
+        for (int k = 0; k < 3; k++)
+            mask[v][k] = _mm_loadu_si128((const __m128i *)UNSHUFFLE3[v][k]);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i in[3];
+        for (int k = 0; k < 3; k++)
+            in[k] = _mm_loadu_si128((const __m128i *)(src[k] + i));
+        for (int v = 0; v < 3; v++) {
+            __m128i out = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(in[0], mask[v][0]),
+                _mm_shuffle_epi8(in[1], mask[v][1])), _mm_shuffle_epi8(in[2], mask[v][2]));
+            _mm_storeu_si128((__m128i *)(dst + 3*i + 16*v), out);
+        }
+    }
+    return i;
+}
+
+// Expand 16 pixels (48 bytes into 64 bytes) at a time. Return the number of pixels processed.
+__attribute__((target("ssse3")))
+static size_t rgb_to_rgba_ssse3(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha) {
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i fill = _mm_set1_epi32((uint32_t)alpha << 24);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i *in = (const __m128i *)(src + 3*i);
+        __m128i *out = (__m128i *)(dst + 4*i);
+        __m128i a = _mm_loadu_si128(in);
+        __m128i b = _mm_loadu_si128(in + 1);
+        __m128i c = _mm_loadu_si128(in + 2);
+        // Each output vector takes 4 pixels (12 bytes) starting at byte 0, 12, 24 and 36
+        _mm_storeu_si128(out, _mm_or_si128(_mm_shuffle_epi8(a, spread), fill));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), spread), fill));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), spread), fill));
+        _mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), spread), fill));
+    }
+    return i;
+}
+
+// Pack 16 pixels (64 bytes into 48 bytes) at a time. Return the number of pixels processed.
+__attribute__((target("ssse3")))
+static size_t rgba_to_rgb_ssse3(const uint8_t *src, uint8_t *dst, size_t count) {
+    const __m128i gather = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i *in = (const __m128i *)(src + 4*i);
+        __m128i *out = (__m128i *)(dst + 3*i);
+        // 12 bytes of RGB in the low part of each vector
+        __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128(in), gather);
+        __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), gather);
+        __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), gather);
+        __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), gather);
+        _mm_storeu_si128(out, _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+    }
+    return i;
+}
+#endif
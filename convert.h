@@ -0,0 +1,25 @@
+/**
+ * @file convert.h
+ * @date 16 Oct 2026
+ * @brief Vectorized conversions between pixel formats.
+ */
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ppm.h"
+
+extern void swap_bytes16(uint16_t *data, size_t count);
+extern void scale16to8(const uint16_t *src, uint8_t *dst, size_t count, unsigned int maxval);
+extern void make_scale_lut(uint8_t lut[256], unsigned int from, unsigned int to);
+extern void scale8(const uint8_t *src, uint8_t *dst, size_t count, unsigned int from, unsigned int to);
+extern void deinterleave3(const uint8_t *src, uint8_t *c0, uint8_t *c1, uint8_t *c2, size_t count);
+extern void interleave3(const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, uint8_t *dst, size_t count);
+extern void rgb_to_rgba(const uint8_t *src, uint8_t *dst, size_t count, uint8_t alpha);
+extern void rgba_to_rgb(const uint8_t *src, uint8_t *dst, size_t count);
+extern img_t *img16_to_img(img16_t *img);
+extern img16_t *img_to_img16(img_t *img);
+
+#endif
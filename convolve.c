@@ -0,0 +1,301 @@
+/**
+ * @file convolve.c
+ * @date 16 Oct 2026
+ * @brief 2D convolution of images with arbitrary kernels.
+ *
+ * The weights are converted to 16-bit fixed point, with as many fractional bits as the
+ * kernel allows without overflowing 32-bit sums. Components are processed 8 at a time
+ * with SSE2: the components of two neighbouring taps are interleaved so that pmaddwd
+ * multiplies them by their weights and adds them in a single instruction. As all
+ * components use the same weights, the interleaved components of a row are treated as a
+ * flat array, the taps of a pixel being 3 components apart.
+ *
+ * The loop over the taps is written once, in an inlined function taking the kernel size
+ * as a parameter. It is instantiated with constant sizes for the common 3x3, 5x5 and 7x7
+ * kernels, whose tap loops the compiler then fully unrolls, and with the size given at
+ * runtime for the other kernels.
+ *
+ * The image is processed in tiles (see tile.h): the windows of the tiles include a halo
+ * of the kernel's radius, with pixels outside of the image made up by the border mode.
+ *
+ * The cost of the direct convolution grows with the square of the kernel size. Large
+ * kernels are applied through FFTs instead (see fft.h), tile by tile (overlap-save): the
+ * window of a tile, padded with zeros to a power of two size at least twice the kernel
+ * size, is transformed, multiplied by the spectrum of the kernel and transformed back.
+ * The circular convolution wraps around, but not over the pixels of the tile itself,
+ * thanks to the halo. Two channels go through a single complex transform, one as the
+ * real part and the other as the imaginary part, as the kernel is real.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "convolve.h"
+#include "fft.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Maximum number of fractional bits of the weights
+#define MAX_SHIFT 14
+
+// Kernels of this size or more are applied through FFTs by convolve
+#define FFT_MIN_KERNEL_SIZE 31
+
+// Range of sizes of the transforms of convolve_fft
+#define MIN_FFT_SIZE 64
+#define MAX_FFT_SIZE 512
+
+typedef struct {
+    img_t *dst;
+    int size;
+    int shift;          // number of fractional bits of the weights
+    int offset;         // added to the results
+    int16_t *weights;   // size*size, row by row
+    int32_t *pairs;     // weights of taps (dx, dx+1) packed for pmaddwd, size*(size+1)/2
+} conv_t;
+
+typedef struct {
+    img_t *dst;
+    int radius;
+    int offset;
+    fft_plan_t *plan;
+    float complex *spectrum;    // of the kernel, scaled by 1/n^2 to make up for the transforms
+} fft_conv_t;
+
+static bool make_weights(conv_t *conv, const float *kernel);
+static double fft_cost(int n, int radius);
+static void convolve_fft_tile(void *arg, const tile_t *tile);
+static void convolve_3(void *arg, const tile_t *tile);
+static void convolve_5(void *arg, const tile_t *tile);
+static void convolve_7(void *arg, const tile_t *tile);
+static void convolve_n(void *arg, const tile_t *tile);
+
+/**
+ * Convolve an image with a square kernel: each component becomes the weighted sum of the
+ * components of the size*size square centered on it, plus offset, saturated to 0..255.
+ * For instance, {0,-1,0, -1,5,-1, 0,-1,0} sharpens an image and {-2,-1,0, -1,1,1, 0,1,2}
+ * with an offset of 128 embosses it.
+ * @param src a pointer to the image to convolve
+ * @param dst a pointer to the image receiving the result, of the same size (not src)
+ * @param kernel the size*size weights, row by row
+ * @param size the width and height of the kernel, odd
+ * @param offset the value added to the weighted sums
+ * @param border how pixels outside of the image are made up
+ * @return false if the images differ in size or are the same, the size is not odd or an
+ *         allocation failed, true otherwise
+ */
+bool convolve(img_t *src, img_t *dst, const float *kernel, int size, int offset, enum BORDER_MODE border) {
+    if (src->width != dst->width || src->height != dst->height || src == dst) return false;
+    if (size < 1 || size % 2 == 0) return false;
+    if (size >= FFT_MIN_KERNEL_SIZE) return convolve_fft(src, dst, kernel, size, offset, border);
+
+    conv_t conv = { dst, size, 0, offset, NULL, NULL };
+    if (!make_weights(&conv, kernel)) return false;
+
+    tile_kernel_t rows = size == 3 ? convolve_3 : size == 5 ? convolve_5 : size == 7 ? convolve_7 : convolve_n;
+    bool ok = for_each_tile(src, src->width, src->height, 0, 0, size / 2, border, rows, &conv);
+    free(conv.weights);
+    free(conv.pairs);
+    return ok;
+}
+
+/**
+ * Convolve an image with a square kernel through FFTs (see convolve, which calls this
+ * routine for large kernels). The results may differ from the direct convolution by 1.
+ * @param src a pointer to the image to convolve
+ * @param dst a pointer to the image receiving the result, of the same size (not src)
+ * @param kernel the size*size weights, row by row
+ * @param size the width and height of the kernel, odd
+ * @param offset the value added to the weighted sums
+ * @param border how pixels outside of the image are made up
+ * @return false if the images differ in size or are the same, the size is not odd or an
+ *         allocation failed, true otherwise
+ */
+bool convolve_fft(img_t *src, img_t *dst, const float *kernel, int size, int offset, enum BORDER_MODE border) {
+    if (src->width != dst->width || src->height != dst->height || src == dst) return false;
+    if (size < 1 || size % 2 == 0) return false;
+
+    // Grow the transforms while it lowers the work per output pixel
+    int r = size / 2;
+    int n = MIN_FFT_SIZE;
+    while (n < 4 * r) n *= 2;
+    while (n < MAX_FFT_SIZE && fft_cost(2 * n, r) < fft_cost(n, r)) n *= 2;
+    fft_conv_t conv = { dst, r, offset, alloc_fft(n), NULL };
+    if (!conv.plan) return false;
+    conv.spectrum = calloc((size_t)n * n, sizeof(float complex));
+    if (!conv.spectrum) {
+        free_fft(conv.plan);
+        return false;
+    }
+
+    // Output pixel (x, y) is the sum of w[a][b]*window[y+a][x+b], that is the circular
+    // convolution of the window with h[-a][-b] = w[a][b]
+    for (int a = 0; a < size; a++)
+        for (int b = 0; b < size; b++)
+            conv.spectrum[(size_t)((n - a) % n) * n + (n - b) % n] = kernel[a*size + b] / ((float)n * n);
+    fft2d(conv.plan, conv.spectrum, false);
+
+    // The window of a tile and its halo fill a transform; each thread keeps the two
+    // transforms of its tiles in its scratch memory
+    int tile_size = n - 2*r;
+    bool ok = for_each_tile_scratch(src, src->width, src->height, tile_size, tile_size, r, border,
+                                    2 * sizeof(float complex) * n * n, convolve_fft_tile, &conv);
+    free(conv.spectrum);
+    free_fft(conv.plan);
+    return ok;
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Convert the weights to fixed point, with the largest number of fractional bits for which
+// the weights fit in 16 bits and the sums in 32 bits.
+static bool make_weights(conv_t *conv, const float *kernel) {
+    int n = conv->size;
+    int npairs = (n + 1) / 2;
+    conv->weights = malloc(sizeof(int16_t) * n * n);
+    conv->pairs = malloc(sizeof(int32_t) * n * npairs);
+    if (!conv->weights || !conv->pairs) {
+        free(conv->weights);
+        free(conv->pairs);
+        return false;
+    }
+
+    double max = 0, total = 0;
+    for (int t = 0; t < n * n; t++) {
+        double w = fabs(kernel[t]);
+        if (w > max) max = w;
+        total += w;
+    }
+    int shift = MAX_SHIFT;
+    double bound = total * 255 + abs(conv->offset) + 1;
+    while (shift > 0 && (max * (1 << shift) > 32767 || bound * (1 << shift) > 2147483647.0))
+        shift--;
+    conv->shift = shift;
+
+    for (int t = 0; t < n * n; t++) {
+        long w = lround(kernel[t] * (1 << shift));
+        conv->weights[t] = w > 32767 ? 32767 : w < -32768 ? -32768 : (int16_t)w;
+    }
+    // The last tap of an odd row is paired with a zero weight
+    for (int dy = 0; dy < n; dy++) {
+        for (int p = 0; p < npairs; p++) {
+            uint16_t w0 = conv->weights[dy*n + 2*p];
+            uint16_t w1 = 2*p + 1 < n ? conv->weights[dy*n + 2*p + 1] : 0;
+            conv->pairs[dy*npairs + p] = (int32_t)(w0 | (uint32_t)w1 << 16);
+        }
+    }
+    return true;
+}
+
+// Convolve a tile with a kernel of n*n taps; inlined with constant values of n, so that
+// the loops over the taps are unrolled.
+static inline __attribute__((always_inline)) void convolve_rows(const conv_t *conv, const tile_t *tile, int n) {
+    int r = n / 2;
+    size_t count = (size_t)3 * tile->width;
+    size_t row_bytes = sizeof(pixel_t) * tile->stride;
+    int32_t round = ((1 << conv->shift) >> 1) + conv->offset * (1 << conv->shift);
+
+    for (int j = 0; j < tile->height; j++) {
+        // Component 0 of the top left tap of the first pixel of the row
+        const uint8_t *base = (const uint8_t *)(tile->window + (j - r) * tile->stride - r);
+        uint8_t *out = (uint8_t *)(conv->dst->pix2d[tile->y + j] + tile->x);
+        size_t i = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 8 <= count; i += 8) {
+            __m128i acc_lo = _mm_set1_epi32(round), acc_hi = acc_lo;
+            for (int dy = 0; dy < n; dy++) {
+                const uint8_t *row = base + dy * row_bytes + i;
+                for (int dx = 0; dx < n; dx += 2) {
+                    __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row + 3*dx)), zero);
+                    __m128i b = dx + 1 < n ?
+                        _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row + 3*dx + 3)), zero) : zero;
+                    __m128i w = _mm_set1_epi32(conv->pairs[dy * ((n + 1) / 2) + dx / 2]);
+                    acc_lo = _mm_add_epi32(acc_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                    acc_hi = _mm_add_epi32(acc_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+                }
+            }
+            __m128i v = _mm_packs_epi32(_mm_srai_epi32(acc_lo, conv->shift), _mm_srai_epi32(acc_hi, conv->shift));
+            _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(v, v));
+        }
+#endif
+        for (; i < count; i++) {
+            int32_t acc = round;
+            for (int dy = 0; dy < n; dy++)
+                for (int dx = 0; dx < n; dx++)
+                    acc += conv->weights[dy*n + dx] * base[dy * row_bytes + i + 3*dx];
+            acc >>= conv->shift;
+            out[i] = acc < 0 ? 0 : acc > 255 ? 255 : acc;
+        }
+    }
+}
+
+#define DEFINE_CONVOLVE(N) \
+    static void convolve_##N(void *arg, const tile_t *tile) { \
+        convolve_rows(arg, tile, N); \
+    }
+
+DEFINE_CONVOLVE(3)
+DEFINE_CONVOLVE(5)
+DEFINE_CONVOLVE(7)
+
+// Any other size, known at runtime only
+static void convolve_n(void *arg, const tile_t *tile) {
+    conv_t *conv = arg;
+    convolve_rows(conv, tile, conv->size);
+}
+
+// Relative work per output pixel of convolve_fft with transforms of size n*n: the tiles
+// have (n - 2*radius)^2 pixels.
+static double fft_cost(int n, int radius) {
+    return (double)n * n * log2(n) / ((double)(n - 2*radius) * (n - 2*radius));
+}
+
+// Convolve a tile through FFTs: the red and green channels as the real and imaginary parts
+// of one transform, the blue one in a second transform.
+static void convolve_fft_tile(void *arg, const tile_t *tile) {
+    fft_conv_t *conv = arg;
+    int n = fft_size(conv->plan), r = conv->radius;
+    float complex *rg = tile->scratch;
+    float complex *b = rg + (size_t)n * n;
+
+    // The scratch buffers hold the previous tile: pad the window with zeros explicitly
+    int ww = tile->width + 2*r, wh = tile->height + 2*r;
+    for (int j = 0; j < wh; j++) {
+        const pixel_t *row = tile->window + (j - r) * tile->stride - r;
+        for (int i = 0; i < ww; i++) {
+            rg[(size_t)j * n + i] = CMPLXF(row[i].r, row[i].g);
+            b[(size_t)j * n + i] = row[i].b;
+        }
+        memset(rg + (size_t)j * n + ww, 0, sizeof(float complex) * (n - ww));
+        memset(b + (size_t)j * n + ww, 0, sizeof(float complex) * (n - ww));
+    }
+    memset(rg + (size_t)wh * n, 0, sizeof(float complex) * (n - wh) * n);
+    memset(b + (size_t)wh * n, 0, sizeof(float complex) * (n - wh) * n);
+
+    fft2d(conv->plan, rg, false);
+    fft2d(conv->plan, b, false);
+    for (size_t k = 0; k < (size_t)n * n; k++) {
+        rg[k] = cmulf(rg[k], conv->spectrum[k]);
+        b[k] = cmulf(b[k], conv->spectrum[k]);
+    }
+    fft2d(conv->plan, rg, true);
+    fft2d(conv->plan, b, true);
+
+    for (int j = 0; j < tile->height; j++) {
+        pixel_t *out = conv->dst->pix2d[tile->y + j] + tile->x;
+        for (int i = 0; i < tile->width; i++) {
+            float v[3] = { crealf(rg[(size_t)j * n + i]), cimagf(rg[(size_t)j * n + i]), crealf(b[(size_t)j * n + i]) };
+            uint8_t c[3];
+            for (int k = 0; k < 3; k++) {
+                float x = floorf(v[k] + conv->offset + 0.5f);
+                c[k] = x < 0 ? 0 : x > 255 ? 255 : (uint8_t)x;
+            }
+            out[i] = (pixel_t){ c[0], c[1], c[2] };
+        }
+    }
+}
@@ -0,0 +1,17 @@
+/**
+ * @file convolve.h
+ * @date 16 Oct 2026
+ * @brief 2D convolution of images with arbitrary kernels.
+ */
+
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+#include <stdbool.h>
+#include "ppm.h"
+#include "tile.h"
+
+extern bool convolve(img_t *src, img_t *dst, const float *kernel, int size, int offset, enum BORDER_MODE border);
+extern bool convolve_fft(img_t *src, img_t *dst, const float *kernel, int size, int offset, enum BORDER_MODE border);
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file fft.c
+ * @date 16 Oct 2026
+ * @brief Fast Fourier transforms of power of two sizes.
+ *
+ * Iterative radix-2 Cooley-Tukey transforms in single precision: the input is permuted
+ * into bit-reversed order, then combined by butterflies of increasing lengths. The plan
+ * holds the twiddle factors and the permutation, computed once per size.
+ *
+ * 2D transforms of n*n arrays transform the rows, transpose the array and transform the
+ * rows again, so that the second pass is contiguous too. The spectrum is left transposed:
+ * pointwise products of spectra don't depend on it, and the inverse transform, which does
+ * the same steps, puts the data back in place.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "fft.h"
+
+struct fft_plan_st {
+    int n;
+    float complex *twiddles;    // exp(-2*pi*i*k/n) for k < n/2
+    int *reverse;               // bit-reversed indices
+};
+
+static void transpose(float complex *data, int n);
+
+/**
+ * Create a plan for transforms of size n.
+ * @param n the size of the transforms, a power of two
+ * @return a pointer to the plan, or NULL if n is not a power of two or the allocation failed
+ */
+fft_plan_t *alloc_fft(int n) {
+    if (n < 1 || (n & (n - 1)) != 0) return NULL;
+    fft_plan_t *plan = malloc(sizeof(fft_plan_t));
+    if (!plan) return NULL;
+
+    plan->n = n;
+    plan->twiddles = malloc(sizeof(float complex) * (n / 2 + 1));
+    plan->reverse = malloc(sizeof(int) * n);
+    if (!plan->twiddles || !plan->reverse) {
+        free(plan->twiddles);
+        free(plan->reverse);
+        free(plan);
+        return NULL;
+    }
+
+    for (int k = 0; k < n / 2; k++) {
+        double angle = -2 * M_PI * k / n;
+        plan->twiddles[k] = (float)cos(angle) + (float)sin(angle) * I;
+    }
+    int bits = 0;
+    while ((1 << bits) < n) bits++;
+    for (int i = 0; i < n; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++)
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        plan->reverse[i] = r;
+    }
+    return plan;
+}
+
+/**
+ * Free a plan.
+ * @param plan a pointer to the plan to free
+ */
+void free_fft(fft_plan_t *plan) {
+    free(plan->twiddles);
+    free(plan->reverse);
+    free(plan);
+}
+
+/**
+ * Return the size of the transforms of a plan.
+ * @param plan a pointer to the plan
+ * @return the size of the transforms
+ */
+int fft_size(fft_plan_t *plan) {
+    return plan->n;
+}
+
+/**
+ * Compute the discrete Fourier transform of an array, in place.
+ * The inverse transform is not scaled: a transform followed by its inverse multiplies
+ * the data by n.
+ * @param plan a pointer to the plan of the size of the array
+ * @param data the n values to transform
+ * @param inverse whether to compute the inverse transform
+ */
+void fft(fft_plan_t *plan, float complex *data, bool inverse) {
+    int n = plan->n;
+    for (int i = 0; i < n; i++) {
+        int r = plan->reverse[i];
+        if (r > i) {
+            float complex t = data[i];
+            data[i] = data[r];
+            data[r] = t;
+        }
+    }
+
+    for (int len = 2; len <= n; len *= 2) {
+        int half = len / 2;
+        int step = n / len;
+        for (int start = 0; start < n; start += len) {
+            float complex *a = data + start, *b = a + half;
+            for (int k = 0; k < half; k++) {
+                float complex w = plan->twiddles[k * step];
+                if (inverse) w = conjf(w);
+                float complex v = cmulf(b[k], w);
+                b[k] = a[k] - v;
+                a[k] += v;
+            }
+        }
+    }
+}
+
+/**
+ * Compute the 2D discrete Fourier transform of a square array, in place.
+ * The spectrum is stored transposed: element [u][v] holds the frequency (v, u). The
+ * inverse transform expects it so and is not scaled (see fft).
+ * @param plan a pointer to the plan of the width (and height) of the array
+ * @param data the n*n values to transform, row by row
+ * @param inverse whether to compute the inverse transform
+ */
+void fft2d(fft_plan_t *plan, float complex *data, bool inverse) {
+    int n = plan->n;
+    for (int j = 0; j < n; j++)
+        fft(plan, data + (size_t)j * n, inverse);
+    transpose(data, n);
+    for (int j = 0; j < n; j++)
+        fft(plan, data + (size_t)j * n, inverse);
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Transpose a square array in place, by blocks staying in the cache.
+static void transpose(float complex *data, int n) {
+    const int block = 16;
+    for (int bj = 0; bj < n; bj += block) {
+        for (int bi = bj; bi < n; bi += block) {
+            for (int j = bj; j < bj + block && j < n; j++) {
+                for (int i = bi == bj ? j + 1 : bi; i < bi + block && i < n; i++) {
+                    float complex t = data[(size_t)j * n + i];
+                    data[(size_t)j * n + i] = data[(size_t)i * n + j];
+                    data[(size_t)i * n + j] = t;
+                }
+            }
+        }
+    }
+}
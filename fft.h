@@ -0,0 +1,33 @@
+/**
+ * @file fft.h
+ * @date 16 Oct 2026
+ * @brief Fast Fourier transforms of power of two sizes.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdbool.h>
+#include <complex.h>
+
+/**
+ * Opaque precomputed tables for transforms of a given size.
+ */
+typedef struct fft_plan_st fft_plan_t;
+
+/**
+ * Multiply two complex numbers, without the special handling of infinities and NaNs of
+ * the * operator (which makes it a library call).
+ */
+static inline float complex cmulf(float complex a, float complex b) {
+    return CMPLXF(crealf(a) * crealf(b) - cimagf(a) * cimagf(b),
+                  crealf(a) * cimagf(b) + cimagf(a) * crealf(b));
+}
+
+extern fft_plan_t *alloc_fft(int n);
+extern void free_fft(fft_plan_t *plan);
+extern int fft_size(fft_plan_t *plan);
+extern void fft(fft_plan_t *plan, float complex *data, bool inverse);
+extern void fft2d(fft_plan_t *plan, float complex *data, bool inverse);
+
+#endif
@@ -0,0 +1,23 @@
+/**
+ * @file lut.h
+ * @date 16 Oct 2026
+ * @brief Lookup table (LUT) application to images, for tone operations.
+ */
+
+#ifndef LUT_H
+#define LUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppm.h"
+
+extern bool apply_lut(img_t *img, int x, int y, int width, int height, const uint8_t lut[256]);
+extern bool apply_lut3(img_t *img, int x, int y, int width, int height, const uint8_t lut_r[256],
+                       const uint8_t lut_g[256], const uint8_t lut_b[256]);
+extern void map_lut3(const uint8_t *src, uint8_t *dst, size_t count, const uint8_t lut_r[256],
+                     const uint8_t lut_g[256], const uint8_t lut_b[256]);
+extern void make_gamma_lut(uint8_t lut[256], double gamma);
+extern void make_invert_lut(uint8_t lut[256]);
+extern void make_threshold_lut(uint8_t lut[256], int threshold);
+
+#endif
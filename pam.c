@@ -0,0 +1,343 @@
+/**
+ * @file pam.c
+ * @date 16 Oct 2026
+ * @brief Routines to read and write PAM (P7) files, in particular RGBA images.
+ *
+ * The PAM file format is described here: http://netpbm.sourceforge.net/doc/pam.html
+ * Only the binary form exists. The header and raster are handled by the same routines as
+ * the other netpbm formats (see pnm.h).
+ * PPM files can also be loaded into RGBA images, with opaque pixels, and RGBA images
+ * written as PPM files, the conversion being done with byte shuffles (see convert.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pam.h"
+#include "pnm.h"
+#include "convert.h"
+
+_Static_assert(sizeof(rgba_t) == 4, "rgba_t must be packed as 4 bytes");
+_Static_assert(PAM_TUPLTYPE_LENGTH == MAX_TUPLTYPE_LENGTH, "tuple type lengths must match");
+
+// Number of pixels converted at once between RGB and RGBA (a multiple of 5, i.e. 15 components)
+#define RGB_CHUNK_PIXELS (5 * 1024)
+
+static bool read_pam_header(FILE *f, ppm_header_t *header);
+static void write_pam_header(FILE *f, int width, int height, int depth, int maxval, char *tupltype);
+
+/**
+ * Allocate the memory for an RGBA image of size width*height
+ * @param width the width of the image to allocate
+ * @param height the height of the image to allocate
+ * @return a pointer to the allocated image or NULL if the allocation failed
+ */
+rgba_img_t *alloc_rgba(int width, int height) {
+    rgba_img_t *img = malloc(sizeof(rgba_img_t));
+
+    if (!img) return NULL;
+
+    img->width = width;
+    img->height = height;
+    img->pix1d = malloc(sizeof(rgba_t) * width * height);
+    if (!img->pix1d) {
+        free(img);
+        return NULL;
+    }
+
+    img->pix2d = malloc(sizeof(rgba_t*) * height);
+    if (!img->pix2d) {
+        free(img->pix1d);
+        free(img);
+        return NULL;
+    }
+
+    for (int i = 0; i < height; i++)
+        img->pix2d[i] = img->pix1d + (size_t)width * i;
+
+    return img;
+}
+
+/**
+ * Free an allocated RGBA image.
+ * @param img a pointer to the image to free
+ */
+void free_rgba(rgba_img_t *img) {
+    free(img->pix1d);
+    free(img->pix2d);
+    free(img);
+}
+
+/**
+ * Load a PAM file as an RGBA image.
+ * Files of depth 1 (grayscale), 2 (grayscale + alpha), 3 (RGB) and 4 (RGB + alpha) are
+ * supported, the alpha channel being opaque when absent. Samples are scaled to 0..255.
+ * The routine takes care of allocating the memory for the image.
+ * @param filename (absolute or relative path) of the image to load
+ * @return a pointer to the loaded image or NULL if an error occured
+ */
+rgba_img_t *load_pam_rgba(char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+
+    rgba_img_t *img = NULL;
+    ppm_header_t header;
+    if (!read_pam_header(f, &header)) goto out;
+    if (header.depth > 4) {
+        fprintf(stderr, "PAM reader: unsupported depth!\n");
+        goto out;
+    }
+
+    img = alloc_rgba(header.width, header.height);
+    if (!img) goto out;
+    size_t count = (size_t)header.width * header.height;
+    size_t samples = count * header.depth;
+    uint8_t *data = (uint8_t *)img->pix1d;
+
+    // Read the samples in bulk at the start of the pixel data, scaled to 8 bits
+    if (header.maxval <= 255) {
+        if (!read_samples(f, &header, data, samples)) goto error;
+    }
+    else {
+        uint16_t *buf = malloc(samples * sizeof(uint16_t));
+        if (!buf) goto error;
+        bool ok = read_samples16(f, &header, buf, samples);
+        if (ok) scale16to8(buf, data, samples, header.maxval);
+        free(buf);
+        if (!ok) goto error;
+    }
+
+    // Expand the tuples to RGBA in place, back to front (a tuple is never larger than a pixel)
+    if (header.depth < 4) {
+        for (size_t i = count; i-- > 0; ) {
+            const uint8_t *t = data + i * header.depth;
+            rgba_t p;
+            switch (header.depth) {
+                case 1: p = (rgba_t){ t[0], t[0], t[0], 255 }; break;
+                case 2: p = (rgba_t){ t[0], t[0], t[0], t[1] }; break;
+                default: p = (rgba_t){ t[0], t[1], t[2], 255 }; break;
+            }
+            img->pix1d[i] = p;
+        }
+    }
+
+out:
+    fclose(f);
+    return img;
+
+error:
+    free_rgba(img);
+    fclose(f);
+    return NULL;
+}
+
+/**
+ * Write an RGBA image as a PAM file of tuple type RGB_ALPHA.
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_pam_rgba(char *filename, rgba_img_t *img) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
+
+    write_pam_header(f, img->width, img->height, 4, 255, "RGB_ALPHA");
+    bool ok = write_samples(f, PPM_RAW, (uint8_t *)img->pix1d, (size_t)4 * img->width * img->height, 255);
+
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+/**
+ * Load a PPM file (either ASCII P3 type or binary P6 type) as a 32-bit per pixel image,
+ * whose fourth byte is set to 255 (opaque). 4-byte pixels can be processed as whole 32-bit
+ * lanes, unlike the 3-byte pixels of img_t.
+ * Files with a maximum value lower than 255 are scaled to 0..255.
+ * @param filename (absolute or relative path) of the image to load
+ * @return a pointer to the loaded image or NULL if an error occured
+ */
+rgba_img_t *load_ppm_rgba(char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+
+    rgba_img_t *img = NULL;
+    uint8_t *buf = NULL;
+    ppm_header_t header;
+    if (!read_header(f, &header)) goto out;
+    if (header.format != 3 && header.format != 6) {
+        fprintf(stderr, "PPM reader: unsupported format!\n");
+        goto out;
+    }
+
+    img = alloc_rgba(header.width, header.height);
+    buf = malloc(3 * RGB_CHUNK_PIXELS);
+    if (!img || !buf) goto error;
+
+    // Decode a chunk of pixels at a time into a small buffer, then expand it
+    size_t count = (size_t)header.width * header.height;
+    for (size_t start = 0; start < count; start += RGB_CHUNK_PIXELS) {
+        size_t n = count - start < RGB_CHUNK_PIXELS ? count - start : RGB_CHUNK_PIXELS;
+        if (!read_samples(f, &header, buf, 3 * n)) goto error;
+        rgb_to_rgba(buf, (uint8_t *)(img->pix1d + start), n, 255);
+    }
+
+out:
+    free(buf);
+    fclose(f);
+    return img;
+
+error:
+    free(buf);
+    if (img) free_rgba(img);
+    fclose(f);
+    return NULL;
+}
+
+/**
+ * Write a 32-bit per pixel image as a PPM file (either ASCII P3 type or binary P6 type).
+ * The fourth byte of the pixels is ignored.
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_ppm_rgba(char *filename, rgba_img_t *img, enum PPM_TYPE type) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
+
+    uint8_t *buf = malloc(3 * RGB_CHUNK_PIXELS);
+    bool ok = buf != NULL;
+
+    char header[MAX_HEADER_LENGTH];
+    format_header(header, type, 3, img->width, img->height, 255);
+    fputs(header, f);
+
+    // Pack a chunk of pixels at a time; a chunk holds a multiple of 15 components so
+    // that the line breaks of ASCII files don't depend on it
+    size_t count = (size_t)img->width * img->height;
+    for (size_t start = 0; ok && start < count; start += RGB_CHUNK_PIXELS) {
+        size_t n = count - start < RGB_CHUNK_PIXELS ? count - start : RGB_CHUNK_PIXELS;
+        rgba_to_rgb((uint8_t *)(img->pix1d + start), buf, n);
+        ok = write_samples(f, type, buf, 3 * n, 255);
+    }
+
+    free(buf);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+/**
+ * Allocate the memory for a PAM image of size width*height
+ * @param width the width of the image to allocate
+ * @param height the height of the image to allocate
+ * @param depth the number of samples per tuple (1 to 255)
+ * @param maxval the maximum value of a sample (1 to 65535)
+ * @param tupltype the tuple type (copied, truncated to PAM_TUPLTYPE_LENGTH), or NULL
+ * @return a pointer to the allocated image or NULL if the allocation failed
+ */
+pam_t *alloc_pam(int width, int height, int depth, int maxval, char *tupltype) {
+    pam_t *img = malloc(sizeof(pam_t));
+
+    if (!img) return NULL;
+
+    img->width = width;
+    img->height = height;
+    img->depth = depth;
+    img->maxval = maxval;
+    snprintf(img->tupltype, sizeof(img->tupltype), "%s", tupltype ? tupltype : "");
+    img->pix1d = malloc(sizeof(uint16_t) * width * height * depth);
+    if (!img->pix1d) {
+        free(img);
+        return NULL;
+    }
+
+    img->pix2d = malloc(sizeof(uint16_t*) * height);
+    if (!img->pix2d) {
+        free(img->pix1d);
+        free(img);
+        return NULL;
+    }
+
+    for (int i = 0; i < height; i++)
+        img->pix2d[i] = img->pix1d + (size_t)width * depth * i;
+
+    return img;
+}
+
+/**
+ * Free an allocated PAM image.
+ * @param img a pointer to the image to free
+ */
+void free_pam(pam_t *img) {
+    free(img->pix1d);
+    free(img->pix2d);
+    free(img);
+}
+
+/**
+ * Load a PAM file of any depth and tuple type, with up to 16 bits per sample.
+ * Samples are stored as is (not scaled), along with the maximum value of the file.
+ * The routine takes care of allocating the memory for the image.
+ * @param filename (absolute or relative path) of the image to load
+ * @return a pointer to the loaded image or NULL if an error occured
+ */
+pam_t *load_pam(char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+
+    pam_t *img = NULL;
+    ppm_header_t header;
+    if (!read_pam_header(f, &header)) goto out;
+
+    img = alloc_pam(header.width, header.height, header.depth, header.maxval, header.tupltype);
+    if (!img) goto out;
+    if (!read_samples16(f, &header, img->pix1d, (size_t)header.width * header.height * header.depth)) {
+        free_pam(img);
+        img = NULL;
+    }
+
+out:
+    fclose(f);
+    return img;
+}
+
+/**
+ * Write a PAM file. Samples use 2 bytes (big endian) when the image's maximum value is
+ * greater than 255, 1 byte otherwise.
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_pam(char *filename, pam_t *img) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
+
+    write_pam_header(f, img->width, img->height, img->depth, img->maxval, img->tupltype);
+    bool ok = write_samples16(f, PPM_RAW, img->pix1d, (size_t)img->width * img->height * img->depth,
+        img->maxval);
+
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Parse a header, making sure it is a PAM one.
+static bool read_pam_header(FILE *f, ppm_header_t *header) {
+    if (!read_header(f, header)) return false;
+    if (header->format != 7) {
+        fprintf(stderr, "PAM reader: unsupported format!\n");
+        return false;
+    }
+    return true;
+}
+
+// Write a PAM header. The tuple type line is omitted if the tuple type is empty.
+static void write_pam_header(FILE *f, int width, int height, int depth, int maxval, char *tupltype) {
+    fprintf(f, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL %d\n", width, height, depth, maxval);
+    if (tupltype[0])
+        fprintf(f, "TUPLTYPE %s\n", tupltype);
+    fprintf(f, "ENDHDR\n");
+}
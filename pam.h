@@ -0,0 +1,76 @@
+/**
+ * @file pam.h
+ * @date 16 Oct 2026
+ * @brief Routines to read and write PAM (P7) files, in particular RGBA images.
+ */
+
+#ifndef PAM_H
+#define PAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppm.h"
+
+// Maximum length of a tuple type, excluding the terminating null character
+#define PAM_TUPLTYPE_LENGTH 63
+
+/**
+ * Store a 32-bit pixel (8-bit per component) with an alpha channel.
+ * Also used for RGB images padded to 4 bytes per pixel (see load_ppm_rgba).
+ * @param r the red component
+ * @param g the green component
+ * @param b the blue component
+ * @param a the alpha component (0 is transparent, 255 is opaque)
+ */
+typedef struct rgba_st {
+    uint8_t r, g, b, a;
+} rgba_t;
+
+/**
+ * Structure holding a 32-bit per pixel RGBA image.
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param pix1d accessor to the image pixel data as a 1D array
+ * @param pix2d accessor to the image pixel data as a 2D array [height][width]
+ */
+typedef struct rgba_img_st {
+    int width;
+    int height;
+    rgba_t *pix1d;
+    rgba_t **pix2d;
+} rgba_img_t;
+
+/**
+ * Structure holding a PAM image of any depth, with up to 16 bits per sample.
+ * Samples are stored as is (not scaled), tuple by tuple, row by row.
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param depth the number of samples per tuple (pixel)
+ * @param maxval the maximum value of a sample (1 to 65535)
+ * @param tupltype the tuple type (e.g. "RGB_ALPHA"), possibly empty
+ * @param pix1d accessor to the samples as a 1D array
+ * @param pix2d accessor to the rows of samples as a 2D array [height][width*depth]
+ */
+typedef struct pam_st {
+    int width;
+    int height;
+    int depth;
+    int maxval;
+    char tupltype[PAM_TUPLTYPE_LENGTH+1];
+    uint16_t *pix1d;
+    uint16_t **pix2d;
+} pam_t;
+
+extern rgba_img_t *alloc_rgba(int width, int height);
+extern void free_rgba(rgba_img_t *img);
+extern rgba_img_t *load_pam_rgba(char *filename);
+extern bool write_pam_rgba(char *filename, rgba_img_t *img);
+extern rgba_img_t *load_ppm_rgba(char *filename);
+extern bool write_ppm_rgba(char *filename, rgba_img_t *img, enum PPM_TYPE type);
+
+extern pam_t *alloc_pam(int width, int height, int depth, int maxval, char *tupltype);
+extern void free_pam(pam_t *img);
+extern pam_t *load_pam(char *filename);
+extern bool write_pam(char *filename, pam_t *img);
+
+#endif
@@ -0,0 +1,255 @@
+/**
+ * @file parallel.c
+ * @date 16 Oct 2026
+ * @brief Parallel execution of kernels over bands of rows, on a persistent thread pool.
+ *
+ * parallel_for splits a range of rows into bands of grain rows, sized so that a band fits
+ * in the L2 cache (see band_grain), and runs a kernel on each band. The pool's threads are
+ * created once and sleep between jobs, so that small images don't pay for thread creation.
+ *
+ * The bands are assigned to the threads in contiguous slices: thread k processes the k-th
+ * slice, which for the same image is always the same rows. Memory first touched by a
+ * kernel thus stays local to the node running the thread processing it. A thread having
+ * finished its slice then takes the remaining bands of the other slices, so that the load
+ * stays balanced when bands have unequal costs or threads are preempted.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+#define CACHE_LINE 64
+
+// Bands [next, end[ of a slice remaining to be processed, alone on its cache line
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_int next;
+    int end;
+} slice_t;
+
+typedef struct {
+    band_kernel_t kernel;
+    void *arg;
+    int first, last;    // rows [first, last[
+    int grain;
+    int nslices;
+    slice_t *slices;    // at most one per thread, the calling thread included
+} job_t;
+
+typedef struct {
+    thread_pool_t *pool;
+    int index;
+} worker_arg_t;
+
+struct thread_pool_st {
+    int nthreads;       // the calling thread included
+    pthread_t *threads;
+    worker_arg_t *args;
+    pthread_mutex_t lock;
+    pthread_cond_t start;       // signaled when a job is posted or the pool is closing
+    pthread_cond_t done;        // signaled when the last worker finishes a job
+    pthread_mutex_t submit;     // serializes the jobs
+    job_t *job;
+    long generation;    // incremented for each job
+    int busy;           // number of workers still processing the job
+    bool closing;
+};
+
+// Index of the current thread in the pool running it, -1 outside of any pool
+static _Thread_local int worker_index = -1;
+
+static thread_pool_t *pool_instance;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static void *worker_thread(void *arg);
+static void run_job(job_t *job, int self);
+static void create_default_pool(void);
+
+/**
+ * Create a thread pool.
+ * @param nthreads the number of threads running the kernels, including the thread calling
+ *        parallel_for, or 0 for the number of online processors
+ * @return a pointer to the pool or NULL if the allocation failed
+ */
+thread_pool_t *alloc_pool(int nthreads) {
+    if (nthreads < 1) nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads < 1) nthreads = 1;
+
+    thread_pool_t *pool = calloc(1, sizeof(thread_pool_t));
+    if (!pool) return NULL;
+    pool->threads = malloc(sizeof(pthread_t) * nthreads);
+    pool->args = malloc(sizeof(worker_arg_t) * nthreads);
+    if (!pool->threads || !pool->args) {
+        free(pool->args);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pthread_mutex_init(&pool->submit, NULL);
+
+    // Thread 0 is the one calling parallel_for; the pool runs with the threads it could create
+    pool->nthreads = 1;
+    for (int i = 1; i < nthreads; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].index = i;
+        if (pthread_create(&pool->threads[i], NULL, worker_thread, &pool->args[i]) != 0) break;
+        pool->nthreads++;
+    }
+    return pool;
+}
+
+/**
+ * Stop the threads of a pool and free it.
+ * @param pool a pointer to the pool to free
+ */
+void free_pool(thread_pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->closing = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->submit);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->args);
+    free(pool->threads);
+    free(pool);
+}
+
+/**
+ * Return the process-wide pool used by the image kernels, with one thread per online
+ * processor. It is created on first use and lives until the process exits.
+ * @return a pointer to the pool, or NULL if it could not be created (kernels then run
+ *         serially)
+ */
+thread_pool_t *default_pool(void) {
+    pthread_once(&pool_once, create_default_pool);
+    return pool_instance;
+}
+
+/**
+ * Return the number of threads of a pool, the calling thread included.
+ * @param pool a pointer to the pool, or NULL
+ * @return the number of threads (1 if pool is NULL)
+ */
+int pool_size(thread_pool_t *pool) {
+    return pool ? pool->nthreads : 1;
+}
+
+/**
+ * Return the number of rows of a band fitting in BAND_BYTES.
+ * @param row_bytes the number of bytes of a row processed by the kernel
+ * @return the number of rows per band, at least 1
+ */
+int band_grain(size_t row_bytes) {
+    size_t grain = row_bytes > 0 ? BAND_BYTES / row_bytes : BAND_BYTES;
+    return grain < 1 ? 1 : grain > 65536 ? 65536 : (int)grain;
+}
+
+/**
+ * Run a kernel over a range of rows split into bands, on the threads of a pool.
+ * The calling thread takes part and the routine returns once all bands are processed.
+ * A kernel may itself call parallel_for, in which case its bands are run serially.
+ * @param pool a pointer to the pool, or NULL to run serially
+ * @param first the first row of the range
+ * @param last the row following the last row of the range
+ * @param grain the number of rows of a band, or 0 to make it so that every thread
+ *        gets a single band
+ * @param kernel the kernel to run on each band
+ * @param arg the argument passed to the kernel
+ */
+void parallel_for(thread_pool_t *pool, int first, int last, int grain, band_kernel_t kernel, void *arg) {
+    if (last <= first) return;
+    int nthreads = pool_size(pool);
+    if (grain < 1) grain = (last - first + nthreads - 1) / nthreads;
+    int nbands = (last - first + grain - 1) / grain;
+
+    // Nothing to share, or called from within a kernel
+    if (nbands == 1 || nthreads == 1 || worker_index >= 0) {
+        for (int row = first; row < last; row += grain)
+            kernel(arg, row, row + grain < last ? row + grain : last);
+        return;
+    }
+
+    if (nthreads > nbands) nthreads = nbands;
+    slice_t slices[nthreads];
+    for (int i = 0; i < nthreads; i++) {
+        atomic_init(&slices[i].next, (long)nbands * i / nthreads);
+        slices[i].end = (long)nbands * (i + 1) / nthreads;
+    }
+    job_t job = { kernel, arg, first, last, grain, nthreads, slices };
+
+    pthread_mutex_lock(&pool->submit);
+    pthread_mutex_lock(&pool->lock);
+    pool->job = &job;
+    pool->generation++;
+    pool->busy = pool->nthreads - 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    worker_index = 0;
+    run_job(&job, 0);
+    worker_index = -1;
+
+    // The job lives on this stack: wait until no worker uses it anymore
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pool->job = NULL;
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->submit);
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+static void *worker_thread(void *arg) {
+    worker_arg_t *warg = arg;
+    thread_pool_t *pool = warg->pool;
+    worker_index = warg->index;
+    long generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->closing && pool->generation == generation)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->closing) break;
+        generation = pool->generation;
+        job_t *job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_job(job, worker_index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Process the bands of the thread's own slice, then those left in the other slices.
+// Threads beyond the number of slices only take remaining bands.
+static void run_job(job_t *job, int self) {
+    for (int k = 0; k < job->nslices; k++) {
+        slice_t *slice = &job->slices[(self + k) % job->nslices];
+        int band;
+        while ((band = atomic_fetch_add(&slice->next, 1)) < slice->end) {
+            int row = job->first + band * job->grain;
+            job->kernel(job->arg, row, row + job->grain < job->last ? row + job->grain : job->last);
+        }
+    }
+}
+
+static void create_default_pool(void) {
+    pool_instance = alloc_pool(0);
+}
@@ -0,0 +1,32 @@
+/**
+ * @file parallel.h
+ * @date 16 Oct 2026
+ * @brief Parallel execution of kernels over bands of rows, on a persistent thread pool.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+// Default size in bytes of the rows of a band (see band_grain)
+#define BAND_BYTES (256 * 1024)
+
+typedef struct thread_pool_st thread_pool_t;
+
+/**
+ * Kernel processing a band of rows.
+ * @param arg the argument given to parallel_for
+ * @param first the first row of the band
+ * @param last the row following the last row of the band
+ */
+typedef void (*band_kernel_t)(void *arg, int first, int last);
+
+extern thread_pool_t *alloc_pool(int nthreads);
+extern void free_pool(thread_pool_t *pool);
+extern thread_pool_t *default_pool(void);
+extern int pool_size(thread_pool_t *pool);
+extern int band_grain(size_t row_bytes);
+extern void parallel_for(thread_pool_t *pool, int first, int last, int grain, band_kernel_t kernel, void *arg);
+
+#endif
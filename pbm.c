@@ -0,0 +1,299 @@
+/**
+ * @file pbm.c
+ * @date 16 Oct 2026
+ * @brief Routines to read and write PBM (bitmap) files and to use bitmaps as masks.
+ *
+ * Both binary (P4 type) and plain ASCII (P1 type) PBM file types are supported.
+ * The PBM file format is described here: http://netpbm.sourceforge.net/doc/pbm.html
+ *
+ * Bitmaps are kept packed in memory (1 bit per pixel), exactly as in P4 files. The mask
+ * routines expand 16 bits at a time into byte masks with SSE2 and apply them to RGB images
+ * with SSSE3 shuffles when the CPU supports it. The polarity of a mask is handled by
+ * flipping the bits on the fly: the bytes of a row are xor-ed with 0 to keep the pixels
+ * whose bit is set, and with 0xFF to keep those whose bit is clear.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pbm.h"
+#include "pnm.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86
+#endif
+
+// Table reversing the order of the bits of a byte
+#define R2(n) n, n + 2*64, n + 1*64, n + 3*64
+#define R4(n) R2(n), R2(n + 2*16), R2(n + 1*16), R2(n + 3*16)
+#define R6(n) R4(n), R4(n + 2*4), R4(n + 1*4), R4(n + 3*4)
+static const uint8_t reverse_bits[256] = { R6(0), R6(2), R6(1), R6(3) };
+
+static void expand_row(const uint8_t *bits, uint8_t *mask, int width, uint8_t flip);
+static void pack_row(const uint8_t *mask, uint8_t *bits, int width, uint8_t flip);
+static void apply_row(pixel_t *row, const uint8_t *bits, int width, uint8_t flip);
+#ifdef HAVE_X86
+static void apply_row_ssse3(pixel_t *row, const uint8_t *bits, int width, uint8_t flip);
+#endif
+
+/**
+ * Allocate the memory for a bitmap of size width*height. All pixels are initially cleared.
+ * @param width the width of the bitmap to allocate
+ * @param height the height of the bitmap to allocate
+ * @return a pointer to the allocated bitmap or NULL if the allocation failed
+ */
+bitmap_t *alloc_bitmap(int width, int height) {
+    bitmap_t *bm = malloc(sizeof(bitmap_t));
+
+    if (!bm) return NULL;
+
+    bm->width = width;
+    bm->height = height;
+    bm->stride = (width + 7) / 8;
+    bm->pix1d = calloc((size_t)bm->stride * height, 1);
+    if (!bm->pix1d) {
+        free(bm);
+        return NULL;
+    }
+
+    bm->pix2d = malloc(sizeof(uint8_t*) * height);
+    if (!bm->pix2d) {
+        free(bm->pix1d);
+        free(bm);
+        return NULL;
+    }
+
+    for (int i = 0; i < height; i++)
+        bm->pix2d[i] = bm->pix1d + (size_t)bm->stride * i;
+
+    return bm;
+}
+
+/**
+ * Free an allocated bitmap.
+ * @param bm a pointer to the bitmap to free
+ */
+void free_bitmap(bitmap_t *bm) {
+    free(bm->pix1d);
+    free(bm->pix2d);
+    free(bm);
+}
+
+/**
+ * Load a PBM file (either ASCII P1 type or binary P4 type).
+ * The routine takes care of allocating the memory for the bitmap.
+ * @param filename (absolute or relative path) of the bitmap to load
+ * @return a pointer to the loaded bitmap or NULL if an error occured
+ */
+bitmap_t *load_pbm(char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+
+    bitmap_t *bm = NULL;
+    ppm_header_t header;
+    if (!read_header(f, &header)) goto out;
+    if (header.format != 1 && header.format != 4) {
+        fprintf(stderr, "PBM reader: unsupported format!\n");
+        goto out;
+    }
+
+    bm = alloc_bitmap(header.width, header.height);
+    if (!bm) goto out;
+
+    if (header.type == PPM_RAW) {
+        // Packed rows, as in memory
+        size_t size = (size_t)bm->stride * bm->height;
+        if (fread(bm->pix1d, 1, size, f) != size) goto error;
+    }
+    else {
+        // One '0' or '1' character per pixel, optionally separated by whitespace
+        for (int j = 0; j < bm->height; j++) {
+            for (int i = 0; i < bm->width; i++) {
+                int c = skip_space(f);
+                if (c != '0' && c != '1') goto error;
+                getc(f);
+                if (c == '1')
+                    bm->pix2d[j][i / 8] |= 0x80 >> (i % 8);
+            }
+        }
+    }
+
+out:
+    fclose(f);
+    return bm;
+
+error:
+    free_bitmap(bm);
+    fclose(f);
+    return NULL;
+}
+
+/**
+ * Write a PBM file (either ASCII P1 type or binary P4 type).
+ * @param filename (absolute or relative path) of the bitmap to write
+ * @param bm a pointer to the bitmap to write
+ * @param PPM_TYPE the type of the bitmap to write (binary or ASCII)
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_pbm(char *filename, bitmap_t *bm, enum PPM_TYPE type) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
+
+    bool ok = true;
+    if (type == PPM_RAW) {
+        fprintf(f, "%s\n%d %d\n", "P4", bm->width, bm->height);
+        size_t size = (size_t)bm->stride * bm->height;
+        ok = fwrite(bm->pix1d, 1, size, f) == size;
+    }
+    else {
+        fprintf(f, "%s\n%d %d\n", "P1", bm->width, bm->height);
+        for (int j = 0; j < bm->height; j++) {
+            for (int i = 0; i < bm->width; i++) {
+                putc(bm->pix2d[j][i / 8] & (0x80 >> (i % 8)) ? '1' : '0', f);
+                if ((i + 1) % 70 == 0 || i == bm->width - 1)  // Max 70 characters/line
+                    putc('\n', f);
+            }
+        }
+    }
+
+    if (ferror(f)) ok = false;
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+/**
+ * Expand a bitmap into a newly allocated byte mask: 255 where the pixel is kept, 0 elsewhere.
+ * @param bm a pointer to the bitmap to expand
+ * @param polarity which pixels are kept: those whose bit is set (MASK_BLACK) or clear
+ *        (MASK_WHITE)
+ * @return a pointer to the mask or NULL if the allocation failed
+ */
+gray_img_t *bitmap_to_mask(bitmap_t *bm, enum MASK_POLARITY polarity) {
+    gray_img_t *mask = alloc_gray(bm->width, bm->height);
+    if (!mask) return NULL;
+    uint8_t flip = polarity == MASK_WHITE ? 0xFF : 0;
+    for (int j = 0; j < bm->height; j++)
+        expand_row(bm->pix2d[j], mask->pix2d[j], bm->width, flip);
+    return mask;
+}
+
+/**
+ * Pack a byte mask into a newly allocated bitmap, the inverse of bitmap_to_mask: the pixels
+ * where the mask is not 0 are kept.
+ * @param mask a pointer to the mask to pack
+ * @param polarity how kept pixels are stored: as set bits (MASK_BLACK) or clear bits
+ *        (MASK_WHITE)
+ * @return a pointer to the bitmap or NULL if the allocation failed
+ */
+bitmap_t *mask_to_bitmap(gray_img_t *mask, enum MASK_POLARITY polarity) {
+    bitmap_t *bm = alloc_bitmap(mask->width, mask->height);
+    if (!bm) return NULL;
+    uint8_t flip = polarity == MASK_WHITE ? 0xFF : 0;
+    for (int j = 0; j < mask->height; j++)
+        pack_row(mask->pix2d[j], bm->pix2d[j], mask->width, flip);
+    return bm;
+}
+
+/**
+ * Apply a bitmap as a mask to an image: the kept pixels are unchanged, the others are set
+ * to black.
+ * @param img a pointer to the image to mask
+ * @param bm a pointer to the bitmap, of the same size as the image
+ * @param polarity which pixels are kept: those whose bit is set (MASK_BLACK) or clear
+ *        (MASK_WHITE)
+ * @return false if the sizes of the image and bitmap differ, true otherwise
+ */
+bool apply_bitmap(img_t *img, bitmap_t *bm, enum MASK_POLARITY polarity) {
+    if (img->width != bm->width || img->height != bm->height) return false;
+
+    void (*apply)(pixel_t *, const uint8_t *, int, uint8_t) = apply_row;
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("ssse3")) apply = apply_row_ssse3;
+#endif
+    uint8_t flip = polarity == MASK_WHITE ? 0xFF : 0;
+    for (int j = 0; j < img->height; j++)
+        apply(img->pix2d[j], bm->pix2d[j], img->width, flip);
+    return true;
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+#ifdef HAVE_X86
+// Expand 16 bits (2 bytes, most significant bit first) into 16 bytes: 0xFF if set, 0 otherwise.
+static inline __m128i expand16(const uint8_t *bits) {
+    const __m128i select = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m128i v = _mm_cvtsi32_si128(bits[0] | bits[1] << 8);
+    // Broadcast the first byte to lanes 0-7 and the second one to lanes 8-15
+    v = _mm_unpacklo_epi8(v, v);
+    v = _mm_unpacklo_epi16(v, v);
+    v = _mm_unpacklo_epi32(v, v);
+    return _mm_cmpeq_epi8(_mm_and_si128(v, select), select);
+}
+#endif
+
+// Expand a packed row, its bits xor-ed with flip, into a byte mask.
+static void expand_row(const uint8_t *bits, uint8_t *mask, int width, uint8_t flip) {
+    int i = 0;
+#ifdef HAVE_X86
+    const __m128i flips = _mm_set1_epi8(flip);
+    for (; i + 16 <= width; i += 16)
+        _mm_storeu_si128((__m128i *)(mask + i), _mm_xor_si128(expand16(bits + i / 8), flips));
+#endif
+    for (; i < width; i++)
+        mask[i] = (bits[i / 8] ^ flip) & (0x80 >> (i % 8)) ? 255 : 0;
+}
+
+// Pack a byte mask into a row of bits xor-ed with flip. The padding bits of the last byte
+// are cleared.
+static void pack_row(const uint8_t *mask, uint8_t *bits, int width, uint8_t flip) {
+    int i = 0;
+#ifdef HAVE_X86
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= width; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *)(mask + i));
+        // Bit k of the movemask is byte k: reverse the bits to get the PBM order
+        int set = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+        bits[i / 8] = reverse_bits[set & 0xFF] ^ flip;
+        bits[i / 8 + 1] = reverse_bits[(set >> 8) & 0xFF] ^ flip;
+    }
+#endif
+    for (; i < width; i++) {
+        if (i % 8 == 0) bits[i / 8] = 0;
+        if (!mask[i] != !flip) bits[i / 8] |= 0x80 >> (i % 8);
+    }
+}
+
+// Clear the pixels of a row whose bit, xor-ed with flip, is not set (scalar version).
+static void apply_row(pixel_t *row, const uint8_t *bits, int width, uint8_t flip) {
+    for (int i = 0; i < width; i++) {
+        if (!((bits[i / 8] ^ flip) & (0x80 >> (i % 8)))) {
+            pixel_t black = { 0, 0, 0 };
+            row[i] = black;
+        }
+    }
+}
+
+#ifdef HAVE_X86
+// Clear the pixels of a row whose bit, xor-ed with flip, is not set, 16 pixels (48 bytes)
+// at a time.
+__attribute__((target("ssse3")))
+static void apply_row_ssse3(pixel_t *row, const uint8_t *bits, int width, uint8_t flip) {
+    // Replicate each byte of the 16 pixel mask for the 3 components of its pixel
+    const __m128i spread0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+    const __m128i spread1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+    const __m128i spread2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+    const __m128i flips = _mm_set1_epi8(flip);
+    int i = 0;
+    for (; i + 16 <= width; i += 16) {
+        __m128i mask = _mm_xor_si128(expand16(bits + i / 8), flips);
+        __m128i *p = (__m128i *)(row + i);
+        _mm_storeu_si128(p, _mm_and_si128(_mm_loadu_si128(p), _mm_shuffle_epi8(mask, spread0)));
+        _mm_storeu_si128(p + 1, _mm_and_si128(_mm_loadu_si128(p + 1), _mm_shuffle_epi8(mask, spread1)));
+        _mm_storeu_si128(p + 2, _mm_and_si128(_mm_loadu_si128(p + 2), _mm_shuffle_epi8(mask, spread2)));
+    }
+    // The remaining pixels start on a byte boundary of the row of bits
+    apply_row(row + i, bits + i / 8, width - i, flip);
+}
+#endif
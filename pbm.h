@@ -0,0 +1,52 @@
+/**
+ * @file pbm.h
+ * @date 16 Oct 2026
+ * @brief Routines to read and write PBM (bitmap) files and to use bitmaps as masks.
+ */
+
+#ifndef PBM_H
+#define PBM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppm.h"
+#include "pgm.h"
+
+/**
+ * Structure holding a 1-bit per pixel image, packed as in binary PBM files:
+ * each row starts on a byte boundary and pixels are stored most significant bit first.
+ * A set bit is a black pixel in the PBM file.
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param stride the number of bytes per row, (width+7)/8
+ * @param pix1d accessor to the packed rows as a 1D array
+ * @param pix2d accessor to the packed rows as a 2D array [height][stride]
+ */
+typedef struct bitmap_st {
+    int width;
+    int height;
+    int stride;
+    uint8_t *pix1d;
+    uint8_t **pix2d;
+} bitmap_t;
+
+/**
+ * Which pixels a bitmap keeps when used as a mask. PBM images are drawn in black (set
+ * bits) on a white background (clear bits): MASK_BLACK keeps what is drawn, MASK_WHITE
+ * keeps the background. Masks expanded from bitmaps are 255 where pixels are kept.
+ */
+enum MASK_POLARITY {
+    MASK_BLACK,     // set bits keep the pixels, clear bits black them out
+    MASK_WHITE      // clear bits keep the pixels, set bits black them out
+};
+
+extern bitmap_t *alloc_bitmap(int width, int height);
+extern void free_bitmap(bitmap_t *bm);
+extern bitmap_t *load_pbm(char *filename);
+extern bool write_pbm(char *filename, bitmap_t *bm, enum PPM_TYPE type);
+
+extern gray_img_t *bitmap_to_mask(bitmap_t *bm, enum MASK_POLARITY polarity);
+extern bitmap_t *mask_to_bitmap(gray_img_t *mask, enum MASK_POLARITY polarity);
+extern bool apply_bitmap(img_t *img, bitmap_t *bm, enum MASK_POLARITY polarity);
+
+#endif
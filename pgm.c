@@ -0,0 +1,212 @@
+/**
+ * @file pgm.c
+ * @date 16 Oct 2026
+ * @brief Routines to read and write PGM (grayscale) files.
+ *
+ * Both binary (P5 type) and plain ASCII (P2 type) PGM file types are supported, with up to
+ * 16 bits per pixel. The PGM file format is described here: http://netpbm.sourceforge.net/doc/pgm.html
+ * The header and raster are handled by the same routines as PPM files (see pnm.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pgm.h"
+#include "pnm.h"
+
+static bool read_pgm_header(FILE *f, ppm_header_t *header);
+
+/**
+ * Allocate the memory for an 8-bit grayscale image of size width*height
+ * @param width the width of the image to allocate
+ * @param height the height of the image to allocate
+ * @return a pointer to the allocated image or NULL if the allocation failed
+ */
+gray_img_t *alloc_gray(int width, int height) {
+    gray_img_t *img = malloc(sizeof(gray_img_t));
+
+    if (!img) return NULL;
+
+    img->width = width;
+    img->height = height;
+    img->pix1d = malloc(sizeof(uint8_t) * width * height);
+    if (!img->pix1d) {
+        free(img);
+        return NULL;
+    }
+
+    img->pix2d = malloc(sizeof(uint8_t*) * height);
+    if (!img->pix2d) {
+        free(img->pix1d);
+        free(img);
+        return NULL;
+    }
+
+    for (int i = 0; i < height; i++)
+        img->pix2d[i] = img->pix1d + (size_t)width * i;
+
+    return img;
+}
+
+/**
+ * Free an allocated 8-bit grayscale image.
+ * @param img a pointer to the image to free
+ */
+void free_gray(gray_img_t *img) {
+    free(img->pix1d);
+    free(img->pix2d);
+    free(img);
+}
+
+/**
+ * Load an 8-bit grayscale PGM file (either ASCII P2 type or binary P5 type).
+ * The routine takes care of allocating the memory for the image.
+ * Files with a maximum value lower than 255 are scaled to 0..255.
+ * @param filename (absolute or relative path) of the image to load
+ * @return a pointer to the loaded image or NULL if an error occured
+ */
+gray_img_t *load_pgm(char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+
+    gray_img_t *img = NULL;
+    ppm_header_t header;
+    if (!read_pgm_header(f, &header)) goto out;
+
+    img = alloc_gray(header.width, header.height);
+    if (!img) goto out;
+    if (!read_samples(f, &header, img->pix1d, (size_t)header.width * header.height)) {
+        free_gray(img);
+        img = NULL;
+    }
+
+out:
+    fclose(f);
+    return img;
+}
+
+/**
+ * Write an 8-bit grayscale PGM file (either ASCII P2 type or binary P5 type).
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_pgm(char *filename, gray_img_t *img, enum PPM_TYPE type) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
+
+    char header[MAX_HEADER_LENGTH];
+    format_header(header, type, 1, img->width, img->height, 255);
+    fputs(header, f);
+    bool ok = write_samples(f, type, img->pix1d, (size_t)img->width * img->height, 255);
+
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+/**
+ * Allocate the memory for a 16-bit grayscale image of size width*height
+ * @param width the width of the image to allocate
+ * @param height the height of the image to allocate
+ * @param maxval the maximum value of a pixel (1 to 65535)
+ * @return a pointer to the allocated image or NULL if the allocation failed
+ */
+gray16_img_t *alloc_gray16(int width, int height, int maxval) {
+    gray16_img_t *img = malloc(sizeof(gray16_img_t));
+
+    if (!img) return NULL;
+
+    img->width = width;
+    img->height = height;
+    img->maxval = maxval;
+    img->pix1d = malloc(sizeof(uint16_t) * width * height);
+    if (!img->pix1d) {
+        free(img);
+        return NULL;
+    }
+
+    img->pix2d = malloc(sizeof(uint16_t*) * height);
+    if (!img->pix2d) {
+        free(img->pix1d);
+        free(img);
+        return NULL;
+    }
+
+    for (int i = 0; i < height; i++)
+        img->pix2d[i] = img->pix1d + (size_t)width * i;
+
+    return img;
+}
+
+/**
+ * Free an allocated 16-bit grayscale image.
+ * @param img a pointer to the image to free
+ */
+void free_gray16(gray16_img_t *img) {
+    free(img->pix1d);
+    free(img->pix2d);
+    free(img);
+}
+
+/**
+ * Load a PGM file (either ASCII P2 type or binary P5 type) with up to 16 bits per pixel.
+ * Pixels are stored as is (not scaled), along with the maximum value of the file.
+ * The routine takes care of allocating the memory for the image.
+ * @param filename (absolute or relative path) of the image to load
+ * @return a pointer to the loaded image or NULL if an error occured
+ */
+gray16_img_t *load_pgm16(char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+
+    gray16_img_t *img = NULL;
+    ppm_header_t header;
+    if (!read_pgm_header(f, &header)) goto out;
+
+    img = alloc_gray16(header.width, header.height, header.maxval);
+    if (!img) goto out;
+    if (!read_samples16(f, &header, img->pix1d, (size_t)header.width * header.height)) {
+        free_gray16(img);
+        img = NULL;
+    }
+
+out:
+    fclose(f);
+    return img;
+}
+
+/**
+ * Write a PGM file (either ASCII P2 type or binary P5 type) with up to 16 bits per pixel.
+ * The image's maximum value is written in the header; binary files use 2 bytes per
+ * pixel (big endian) when it is greater than 255, 1 byte otherwise.
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_pgm16(char *filename, gray16_img_t *img, enum PPM_TYPE type) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
+
+    char header[MAX_HEADER_LENGTH];
+    format_header(header, type, 1, img->width, img->height, img->maxval);
+    fputs(header, f);
+    bool ok = write_samples16(f, type, img->pix1d, (size_t)img->width * img->height, img->maxval);
+
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Parse a header, making sure it is a PGM one.
+static bool read_pgm_header(FILE *f, ppm_header_t *header) {
+    if (!read_header(f, header)) return false;
+    if (header->format != 2 && header->format != 5) {
+        fprintf(stderr, "PGM reader: unsupported format!\n");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file pgm.h
+ * @date 16 Oct 2026
+ * @brief Routines to read and write PGM (grayscale) files.
+ */
+
+#ifndef PGM_H
+#define PGM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppm.h"
+
+/**
+ * Structure holding an 8-bit grayscale image.
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param pix1d accessor to the image pixel data as a 1D array
+ * @param pix2d accessor to the image pixel data as a 2D array [height][width]
+ */
+typedef struct gray_img_st {
+    int width;
+    int height;
+    uint8_t *pix1d;
+    uint8_t **pix2d;
+} gray_img_t;
+
+/**
+ * Structure holding a 16-bit grayscale image.
+ * Pixel values range from 0 to maxval (at most 65535).
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param maxval the maximum value of a pixel
+ * @param pix1d accessor to the image pixel data as a 1D array
+ * @param pix2d accessor to the image pixel data as a 2D array [height][width]
+ */
+typedef struct gray16_img_st {
+    int width;
+    int height;
+    int maxval;
+    uint16_t *pix1d;
+    uint16_t **pix2d;
+} gray16_img_t;
+
+extern gray_img_t *alloc_gray(int width, int height);
+extern void free_gray(gray_img_t *img);
+extern gray_img_t *load_pgm(char *filename);
+extern bool write_pgm(char *filename, gray_img_t *img, enum PPM_TYPE type);
+
+extern gray16_img_t *alloc_gray16(int width, int height, int maxval);
+extern void free_gray16(gray16_img_t *img);
+extern gray16_img_t *load_pgm16(char *filename);
+extern bool write_pgm16(char *filename, gray16_img_t *img, enum PPM_TYPE type);
+
+#endif
@@ -0,0 +1,397 @@
+/**
+ * @file pipeline.c
+ * @date 16 Oct 2026
+ * @brief Pipelines of image operations, fused and executed in a single pass.
+ *
+ * Operations are recorded, not executed: nothing is computed until the pipeline is run.
+ * Recording fuses them, so that running the pipeline writes each output pixel once,
+ * without intermediate images:
+ * - crops compose into a single rectangle of the source image, each one within the
+ *   rectangle of the previous ones;
+ * - point operations on each channel (brightness, contrast, lookup tables) compose into
+ *   one table per channel;
+ * - the gray conversion only depends on the 3 components of a pixel, and its output has
+ *   3 equal components: the operations following it compose into tables indexed by the
+ *   gray level, and a second gray conversion turns these tables into a single one.
+ * Point operations thus boil down to tables, an optional gray conversion and tables.
+ *
+ * A pipeline may also hold one local operation, a convolution, between
+ * the point operations recorded before it and those recorded after it; crops can only
+ * come before it. Without it, the output is computed in bands of rows on the default
+ * thread pool (see parallel.h), reading each source pixel once. With it, the output is
+ * computed in tiles (see tile.h): the window of a tile, with a halo of the kernel's
+ * radius, is gathered from the source rectangle and goes through the point operations
+ * preceding the convolution, then the convolved pixels of the tile go through the point
+ * operations following it and are written to the output. Only the halos are read and
+ * mapped more than once. Either way the output goes into an image or straight to a PPM
+ * stream, band by band.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pipeline.h"
+#include "adjust.h"
+#include "lut.h"
+#include "parallel.h"
+
+// Fused point operations
+typedef struct {
+    uint8_t pre[3][256];    // tables applied to the components
+    bool gray;              // whether a gray conversion follows
+    uint8_t post[3][256];   // tables applied to the gray level
+} point_ops_t;
+
+struct pipeline_st {
+    int x, y;           // crop rectangle, relative to the source image
+    int width, height;  // -1 while no crop was recorded
+    point_ops_t before;     // point operations before the local operation (all if none)
+    float *weights;         // kernel of the local operation, size*size, NULL if none
+    int size;
+    int offset;
+    enum BORDER_MODE border;
+    point_ops_t after;      // point operations after the local operation
+};
+
+// Rectangle of a source image mapped into rows of an output
+typedef struct {
+    pipeline_t *p;
+    img_t *src;
+    pixel_t *dst;       // output row of the first row of the band
+    int dst_stride;     // number of pixels between two output rows, the output width
+    int height;         // output height
+    int first;          // output row stored at dst
+    bool failed;        // whether a band could not be computed
+} pipeline_run_t;
+
+static inline uint8_t luma(int r, int g, int b);
+static void init_point_ops(point_ops_t *ops);
+static void compose(uint8_t table[256], const uint8_t lut[256]);
+static bool resolve(pipeline_t *p, img_t *src, int *width, int *height);
+static bool run_rows(pipeline_run_t *run, int count);
+static void run_band(void *arg, int first, int last);
+static void run_tile(void *arg, const tile_t *tile);
+static void produce_rows(void *arg, pixel_t *rows, int first, int count);
+static void point_row(const point_ops_t *ops, const pixel_t *src, pixel_t *dst, int width);
+
+/**
+ * Create an empty pipeline, which copies its source image.
+ * @return a pointer to the pipeline or NULL if the allocation failed
+ */
+pipeline_t *alloc_pipeline(void) {
+    pipeline_t *p = malloc(sizeof(pipeline_t));
+    if (!p) return NULL;
+
+    p->x = p->y = 0;
+    p->width = p->height = -1;
+    init_point_ops(&p->before);
+    p->weights = NULL;
+    p->size = p->offset = 0;
+    p->border = BORDER_CLAMP;
+    init_point_ops(&p->after);
+    return p;
+}
+
+/**
+ * Free a pipeline.
+ * @param p a pointer to the pipeline to free
+ */
+void free_pipeline(pipeline_t *p) {
+    free(p->weights);
+    free(p);
+}
+
+/**
+ * Record a crop: the following operations, and the output, only cover the given rectangle
+ * of the current image. The rectangle must lie within the previous crop, if any; the first
+ * crop is checked against the source image when the pipeline is run.
+ * @param p a pointer to the pipeline
+ * @param x the left coordinate of the rectangle in the current image
+ * @param y the top coordinate of the rectangle in the current image
+ * @param width the width of the rectangle
+ * @param height the height of the rectangle
+ * @return false (leaving the pipeline unchanged) if a coordinate or size is negative, the
+ *         rectangle doesn't fit within the previous crop or a local operation was
+ *         recorded, true otherwise
+ */
+bool pipeline_crop(pipeline_t *p, int x, int y, int width, int height) {
+    if (x < 0 || y < 0 || width < 0 || height < 0 || p->weights) return false;
+    if (p->width >= 0 && (x > p->width - width || y > p->height - height)) return false;
+    p->x += x;
+    p->y += y;
+    p->width = width;
+    p->height = height;
+    return true;
+}
+
+/**
+ * Record a brightness adjustment (see adjust_brightness).
+ * @param p a pointer to the pipeline
+ * @param gain the factor applied to the components (0 to 256, with a precision of 1/256)
+ * @param offset the value added to the components after scaling (-255 to 255)
+ */
+void pipeline_brightness(pipeline_t *p, float gain, int offset) {
+    uint8_t lut[256];
+    make_adjust_lut(lut, gain, offset);
+    pipeline_lut(p, lut);
+}
+
+/**
+ * Record a contrast adjustment (see adjust_contrast).
+ * @param p a pointer to the pipeline
+ * @param contrast the contrast factor (1 keeps the contrast unchanged, 0 to 2)
+ * @param brightness the value added to the components (-127 to 127)
+ */
+void pipeline_contrast(pipeline_t *p, float contrast, int brightness) {
+    pipeline_brightness(p, contrast, 128 + brightness - (int)(128 * contrast + 0.5f));
+}
+
+/**
+ * Record the mapping of every component through a lookup table (see apply_lut).
+ * @param p a pointer to the pipeline
+ * @param lut the table: a component v becomes lut[v]
+ */
+void pipeline_lut(pipeline_t *p, const uint8_t lut[256]) {
+    pipeline_lut3(p, lut, lut, lut);
+}
+
+/**
+ * Record the mapping of the components through one lookup table per channel (see apply_lut3).
+ * @param p a pointer to the pipeline
+ * @param lut_r the table of the red components
+ * @param lut_g the table of the green components
+ * @param lut_b the table of the blue components
+ */
+void pipeline_lut3(pipeline_t *p, const uint8_t lut_r[256], const uint8_t lut_g[256],
+                   const uint8_t lut_b[256]) {
+    point_ops_t *ops = p->weights ? &p->after : &p->before;
+    const uint8_t *luts[3] = { lut_r, lut_g, lut_b };
+    for (int k = 0; k < 3; k++)
+        compose(ops->gray ? ops->post[k] : ops->pre[k], luts[k]);
+}
+
+/**
+ * Record a conversion to gray: the 3 components of a pixel are replaced by its luma
+ * (0.299*r + 0.587*g + 0.114*b, in 8.8 fixed point).
+ * @param p a pointer to the pipeline
+ */
+void pipeline_gray(pipeline_t *p) {
+    point_ops_t *ops = p->weights ? &p->after : &p->before;
+    if (!ops->gray) {
+        ops->gray = true;
+        return;
+    }
+    // The current output of a gray level v is (post[0][v], post[1][v], post[2][v])
+    for (int v = 0; v < 256; v++)
+        ops->post[0][v] = ops->post[1][v] = ops->post[2][v] = luma(ops->post[0][v], ops->post[1][v], ops->post[2][v]);
+}
+
+/**
+ * Record a convolution with a square kernel, the local operation of the pipeline: each
+ * component becomes the weighted sum of the components of the size*size square centered
+ * on it, plus offset, saturated to 0..255. The sums are computed in single precision.
+ * @param p a pointer to the pipeline
+ * @param kernel the size*size weights, row by row
+ * @param size the width and height of the kernel, odd
+ * @param offset the value added to the weighted sums
+ * @param border how pixels outside of the current image are made up
+ * @return false (leaving the pipeline unchanged) if the size is not odd, a local operation
+ *         was already recorded or the allocation failed, true otherwise
+ */
+bool pipeline_convolve(pipeline_t *p, const float *kernel, int size, int offset, enum BORDER_MODE border) {
+    if (size < 1 || size % 2 == 0 || p->weights) return false;
+    p->weights = malloc(sizeof(float) * size * size);
+    if (!p->weights) return false;
+    memcpy(p->weights, kernel, sizeof(float) * size * size);
+    p->size = size;
+    p->offset = offset;
+    p->border = border;
+    return true;
+}
+
+/**
+ * Run a pipeline on an image, producing a newly allocated image.
+ * @param p a pointer to the pipeline
+ * @param src a pointer to the source image (unchanged)
+ * @return a pointer to the output image, or NULL if the crop rectangle doesn't fit within
+ *         the source image or an allocation failed
+ */
+img_t *run_pipeline(pipeline_t *p, img_t *src) {
+    int width, height;
+    if (!resolve(p, src, &width, &height)) return NULL;
+    img_t *dst = alloc_img(width, height);
+    if (!dst) return NULL;
+    if (!run_pipeline_into(p, src, dst)) {
+        free_img(dst);
+        return NULL;
+    }
+    return dst;
+}
+
+/**
+ * Run a pipeline on an image, writing the output into an existing image.
+ * @param p a pointer to the pipeline
+ * @param src a pointer to the source image
+ * @param dst a pointer to the output image, of the size of the output; it may be src
+ *        when the pipeline neither crops nor convolves
+ * @return false if the crop rectangle doesn't fit within the source image, the output
+ *         image doesn't have the size of the output, is src while the pipeline convolves
+ *         or an allocation failed, true otherwise
+ */
+bool run_pipeline_into(pipeline_t *p, img_t *src, img_t *dst) {
+    int width, height;
+    if (!resolve(p, src, &width, &height)) return false;
+    if (dst->width != width || dst->height != height) return false;
+    if (dst == src && p->weights) return false;
+
+    pipeline_run_t run = { p, src, dst->pix1d, width, height, 0, false };
+    return run_rows(&run, height);
+}
+
+/**
+ * Run a pipeline on an image, appending the output to a PPM stream. The output is
+ * computed and written band by band, without being held whole in memory.
+ * @param p a pointer to the pipeline
+ * @param src a pointer to the source image
+ * @param writer the writer returned by open_ppm_writer
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @return false if the crop rectangle doesn't fit within the source image, an allocation
+ *         or the write failed, true otherwise
+ */
+bool stream_pipeline(pipeline_t *p, img_t *src, ppm_writer_t *writer, enum PPM_TYPE type) {
+    int width, height;
+    if (!resolve(p, src, &width, &height)) return false;
+
+    pipeline_run_t run = { p, src, NULL, width, height, 0, false };
+    bool ok = append_ppm_rows(writer, width, height, type, produce_rows, &run);
+    return ok && !run.failed;
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Luma of a pixel, in 8.8 fixed point (the weights sum up to 256).
+static inline uint8_t luma(int r, int g, int b) {
+    return (77 * r + 150 * g + 29 * b + 128) >> 8;
+}
+
+// Make point operations that leave the components unchanged.
+static void init_point_ops(point_ops_t *ops) {
+    for (int k = 0; k < 3; k++)
+        for (int v = 0; v < 256; v++)
+            ops->pre[k][v] = ops->post[k][v] = v;
+    ops->gray = false;
+}
+
+// Make table the composition of table followed by lut.
+static void compose(uint8_t table[256], const uint8_t lut[256]) {
+    for (int v = 0; v < 256; v++)
+        table[v] = lut[table[v]];
+}
+
+// Compute the size of the output for a source image, checking the crop rectangle.
+static bool resolve(pipeline_t *p, img_t *src, int *width, int *height) {
+    *width = p->width < 0 ? src->width - p->x : p->width;
+    *height = p->height < 0 ? src->height - p->y : p->height;
+    return p->x >= 0 && p->y >= 0 && *width >= 0 && *height >= 0 &&
+           p->x <= src->width - *width && p->y <= src->height - *height;
+}
+
+// Compute output rows [first, first+count[ in parallel, by bands of rows or by tiles.
+static bool run_rows(pipeline_run_t *run, int count) {
+    pipeline_t *p = run->p;
+    if (!p->weights) {
+        parallel_for(default_pool(), run->first, run->first + count,
+                     band_grain(sizeof(pixel_t) * run->dst_stride), run_band, run);
+        return true;
+    }
+    int window = DEFAULT_TILE_SIZE + 2 * (p->size / 2);
+    return for_each_tile_scratch(NULL, run->dst_stride, count, DEFAULT_TILE_SIZE, DEFAULT_TILE_SIZE, 0,
+                                 p->border, sizeof(pixel_t) * window * window, run_tile, run);
+}
+
+// Compute output rows [first, last[ of a pipeline without local operation.
+static void run_band(void *arg, int first, int last) {
+    pipeline_run_t *run = arg;
+    pipeline_t *p = run->p;
+    for (int j = first; j < last; j++) {
+        const pixel_t *src = run->src->pix2d[p->y + j] + p->x;
+        pixel_t *dst = run->dst + (size_t)(j - run->first) * run->dst_stride;
+        point_row(&p->before, src, dst, run->dst_stride);
+    }
+}
+
+// Compute a tile of output rows [first, first+count[ of a pipeline with a convolution.
+// The tile's window is gathered in the scratch memory, as tile.c would, but from the
+// source rectangle and through the point operations preceding the convolution.
+static void run_tile(void *arg, const tile_t *tile) {
+    pipeline_run_t *run = arg;
+    pipeline_t *p = run->p;
+    int r = p->size / 2;
+    int stride = tile->width + 2*r;
+    pixel_t *window = tile->scratch;
+
+    for (int j = 0; j < tile->height + 2*r; j++) {
+        pixel_t *row = window + (size_t)j * stride;
+        int y = border_index(run->first + tile->y + j - r, run->height, p->border);
+        if (y < 0) {
+            memset(row, 0, sizeof(pixel_t) * stride);
+            continue;
+        }
+        const pixel_t *src = run->src->pix2d[p->y + y] + p->x;
+        for (int i = 0; i < stride; i++) {
+            int x = border_index(tile->x + i - r, run->dst_stride, p->border);
+            row[i] = src[x < 0 ? 0 : x];
+        }
+        point_row(&p->before, row, row, stride);
+        // Black pixels are made up after the point operations
+        if (p->border == BORDER_ZERO) {
+            for (int i = 0; i < stride; i++)
+                if (border_index(tile->x + i - r, run->dst_stride, p->border) < 0) row[i] = (pixel_t){ 0, 0, 0 };
+        }
+    }
+
+    for (int j = 0; j < tile->height; j++) {
+        pixel_t *out = run->dst + (size_t)(tile->y + j) * run->dst_stride + tile->x;
+        for (int i = 0; i < tile->width; i++) {
+            float sum[3] = { 0, 0, 0 };
+            const float *w = p->weights;
+            for (int a = 0; a < p->size; a++) {
+                const pixel_t *q = window + (size_t)(j + a) * stride + i;
+                for (int b = 0; b < p->size; b++, w++) {
+                    sum[0] += *w * q[b].r;
+                    sum[1] += *w * q[b].g;
+                    sum[2] += *w * q[b].b;
+                }
+            }
+            uint8_t c[3];
+            for (int k = 0; k < 3; k++) {
+                float x = floorf(sum[k] + p->offset + 0.5f);
+                c[k] = x < 0 ? 0 : x > 255 ? 255 : (uint8_t)x;
+            }
+            out[i] = (pixel_t){ c[0], c[1], c[2] };
+        }
+        point_row(&p->after, out, out, tile->width);
+    }
+}
+
+// Producer of append_ppm_rows, computing a band of rows in parallel.
+static void produce_rows(void *arg, pixel_t *rows, int first, int count) {
+    pipeline_run_t *run = arg;
+    run->dst = rows;
+    run->first = first;
+    if (!run_rows(run, count)) run->failed = true;
+}
+
+// Apply point operations to a row (src may be dst).
+static void point_row(const point_ops_t *ops, const pixel_t *src, pixel_t *dst, int width) {
+    if (!ops->gray) {
+        map_lut3((const uint8_t *)src, (uint8_t *)dst, (size_t)3 * width, ops->pre[0], ops->pre[1], ops->pre[2]);
+        return;
+    }
+    for (int i = 0; i < width; i++) {
+        uint8_t y = luma(ops->pre[0][src[i].r], ops->pre[1][src[i].g], ops->pre[2][src[i].b]);
+        dst[i] = (pixel_t){ ops->post[0][y], ops->post[1][y], ops->post[2][y] };
+    }
+}
@@ -0,0 +1,34 @@
+/**
+ * @file pipeline.h
+ * @date 16 Oct 2026
+ * @brief Pipelines of image operations, fused and executed in a single pass.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppm.h"
+#include "tile.h"
+
+/**
+ * Opaque sequence of operations applied to an image.
+ */
+typedef struct pipeline_st pipeline_t;
+
+extern pipeline_t *alloc_pipeline(void);
+extern void free_pipeline(pipeline_t *p);
+extern bool pipeline_crop(pipeline_t *p, int x, int y, int width, int height);
+extern void pipeline_brightness(pipeline_t *p, float gain, int offset);
+extern void pipeline_contrast(pipeline_t *p, float contrast, int brightness);
+extern void pipeline_lut(pipeline_t *p, const uint8_t lut[256]);
+extern void pipeline_lut3(pipeline_t *p, const uint8_t lut_r[256], const uint8_t lut_g[256],
+                          const uint8_t lut_b[256]);
+extern void pipeline_gray(pipeline_t *p);
+extern bool pipeline_convolve(pipeline_t *p, const float *kernel, int size, int offset, enum BORDER_MODE border);
+extern img_t *run_pipeline(pipeline_t *p, img_t *src);
+extern bool run_pipeline_into(pipeline_t *p, img_t *src, img_t *dst);
+extern bool stream_pipeline(pipeline_t *p, img_t *src, ppm_writer_t *writer, enum PPM_TYPE type);
+
+#endif
@@ -0,0 +1,139 @@
+/**
+ * @file planar.c
+ * @date 16 Oct 2026
+ * @brief Planar (one array per component) RGB images.
+ *
+ * Keeping each component in its own aligned array lets per-channel filters process full
+ * vectors of a single component instead of interleaved RGB triplets. Conversions to and
+ * from interleaved images are done with the shuffle routines of convert.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "planar.h"
+#include "convert.h"
+#include "pnm.h"
+
+// Number of bytes of raster decoded at once by load_ppm_planar
+#define ROWS_BUFFER_SIZE (64*1024)
+
+/**
+ * Allocate the memory for a planar image of size width*height.
+ * @param width the width of the image to allocate
+ * @param height the height of the image to allocate
+ * @return a pointer to the allocated image or NULL if the allocation failed
+ */
+planar_img_t *alloc_planar(int width, int height) {
+    planar_img_t *img = malloc(sizeof(planar_img_t));
+
+    if (!img) return NULL;
+
+    img->width = width;
+    img->height = height;
+    img->stride = (width + PLANE_ALIGNMENT - 1) / PLANE_ALIGNMENT * PLANE_ALIGNMENT;
+    // The size of a plane is a multiple of the alignment, as required by aligned_alloc
+    size_t size = (size_t)img->stride * height;
+    if (size == 0) size = PLANE_ALIGNMENT;
+    for (int k = 0; k < 3; k++) {
+        img->plane[k] = aligned_alloc(PLANE_ALIGNMENT, size);
+        if (!img->plane[k]) {
+            while (k--) free(img->plane[k]);
+            free(img);
+            return NULL;
+        }
+    }
+
+    return img;
+}
+
+/**
+ * Free an allocated planar image.
+ * @param img a pointer to the image to free
+ */
+void free_planar(planar_img_t *img) {
+    for (int k = 0; k < 3; k++)
+        free(img->plane[k]);
+    free(img);
+}
+
+/**
+ * Load a PPM file (either ASCII P3 type or binary P6 type) directly into planar form.
+ * The raster is decoded a few rows at a time, without an intermediate interleaved image.
+ * Files with a maximum value lower than 255 are scaled to 0..255.
+ * @param filename (absolute or relative path) of the image to load
+ * @return a pointer to the loaded image or NULL if an error occured
+ */
+planar_img_t *load_ppm_planar(char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+
+    planar_img_t *img = NULL;
+    uint8_t *rows = NULL;
+    ppm_header_t header;
+    if (!read_header(f, &header)) goto out;
+    if (header.format != 3 && header.format != 6) {
+        fprintf(stderr, "PPM reader: unsupported format!\n");
+        goto out;
+    }
+
+    img = alloc_planar(header.width, header.height);
+    if (!img) goto out;
+
+    size_t row_size = (size_t)img->width * 3;
+    int nrows = row_size > 0 && row_size < ROWS_BUFFER_SIZE ? ROWS_BUFFER_SIZE / row_size : 1;
+    rows = malloc(row_size * nrows);
+    if (!rows) goto error;
+
+    for (int j = 0; j < img->height; j += nrows) {
+        int n = img->height - j < nrows ? img->height - j : nrows;
+        if (!read_samples(f, &header, rows, row_size * n)) goto error;
+        for (int i = 0; i < n; i++) {
+            size_t offset = (size_t)(j + i) * img->stride;
+            deinterleave3(rows + row_size*i, img->plane[0] + offset, img->plane[1] + offset,
+                          img->plane[2] + offset, img->width);
+        }
+    }
+
+out:
+    free(rows);
+    fclose(f);
+    return img;
+
+error:
+    free(rows);
+    free_planar(img);
+    fclose(f);
+    return NULL;
+}
+
+/**
+ * Convert an RGB image into a newly allocated planar image.
+ * @param img a pointer to the image to convert
+ * @return a pointer to the planar image or NULL if the allocation failed
+ */
+planar_img_t *img_to_planar(img_t *img) {
+    planar_img_t *planar = alloc_planar(img->width, img->height);
+    if (!planar) return NULL;
+    for (int j = 0; j < img->height; j++) {
+        size_t offset = (size_t)j * planar->stride;
+        deinterleave3((uint8_t *)img->pix2d[j], planar->plane[0] + offset,
+                      planar->plane[1] + offset, planar->plane[2] + offset, img->width);
+    }
+    return planar;
+}
+
+/**
+ * Convert a planar image into a newly allocated RGB image.
+ * @param img a pointer to the planar image to convert
+ * @return a pointer to the RGB image or NULL if the allocation failed
+ */
+img_t *planar_to_img(planar_img_t *img) {
+    img_t *rgb = alloc_img(img->width, img->height);
+    if (!rgb) return NULL;
+    for (int j = 0; j < img->height; j++) {
+        size_t offset = (size_t)j * img->stride;
+        interleave3(img->plane[0] + offset, img->plane[1] + offset, img->plane[2] + offset,
+                    (uint8_t *)rgb->pix2d[j], img->width);
+    }
+    return rgb;
+}
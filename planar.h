@@ -0,0 +1,39 @@
+/**
+ * @file planar.h
+ * @date 16 Oct 2026
+ * @brief Planar (one array per component) RGB images.
+ */
+
+#ifndef PLANAR_H
+#define PLANAR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppm.h"
+
+// Alignment in bytes of the planes and of their rows
+#define PLANE_ALIGNMENT 64
+
+/**
+ * Structure holding an RGB image as 3 separate planes, in the R, G, B order.
+ * Each row of a plane starts on a PLANE_ALIGNMENT boundary, so that row j of plane k is
+ * at plane[k] + j*stride; the padding at the end of the rows is left unspecified.
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param stride the distance in bytes between the starts of 2 consecutive rows
+ * @param plane accessors to the 3 component planes
+ */
+typedef struct planar_img_st {
+    int width;
+    int height;
+    int stride;
+    uint8_t *plane[3];
+} planar_img_t;
+
+extern planar_img_t *alloc_planar(int width, int height);
+extern void free_planar(planar_img_t *img);
+extern planar_img_t *load_ppm_planar(char *filename);
+extern planar_img_t *img_to_planar(img_t *img);
+extern img_t *planar_to_img(planar_img_t *img);
+
+#endif
@@ -0,0 +1,351 @@
+/**
+ * @file pnm.c
+ * @date 16 Oct 2026
+ * @brief Internal routines shared by the readers and writers of the netpbm formats.
+ *
+ * Headers are tokenized straight from the stream (whitespace and comments may appear
+ * anywhere), which leaves the stream on the first byte of the raster. The rasters of all
+ * formats are then read and written in bulk as flat arrays of components.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+#include "pnm.h"
+#include "convert.h"
+
+// Maximum length of a PAM header keyword
+#define MAX_KEYWORD_LENGTH 16
+
+// Number of components converted at once when the file's representation differs from memory
+#define CHUNK_SIZE (15 * 1024)
+
+/**
+ * Skip whitespace and comments (from '#' to the end of the line).
+ * @param f the stream
+ * @return the next character, which is left in the stream, or EOF
+ */
+int skip_space(FILE *f) {
+    int c;
+    while ((c = getc(f)) != EOF) {
+        if (c == '#') {
+            while ((c = getc(f)) != EOF && c != '\n' && c != '\r');
+            if (c == EOF) break;
+        }
+        else if (!isspace(c)) {
+            ungetc(c, f);
+            break;
+        }
+    }
+    return c;
+}
+
+/**
+ * Read an unsigned decimal integer, skipping any leading whitespace and comments.
+ * The character which terminates the number is consumed, unless it starts a comment.
+ * @param f the stream
+ * @param val where to store the value
+ * @return whether a number was read
+ */
+bool read_uint(FILE *f, unsigned int *val) {
+    int c = skip_space(f);
+    if (c == EOF || !isdigit(c)) return false;
+
+    unsigned long v = 0;
+    while ((c = getc(f)) != EOF && isdigit(c)) {
+        v = v * 10 + (c - '0');
+        if (v > UINT_MAX) return false;
+    }
+    if (c == '#') ungetc(c, f);
+    *val = v;
+    return true;
+}
+
+static bool check_header(ppm_header_t *header);
+static bool read_pam_header(FILE *f, ppm_header_t *header);
+
+/**
+ * Parse a PPM (P3, P6), PGM (P2, P5), PBM (P1, P4) or PAM (P7) header.
+ * On success, the stream is positioned on the first byte of the raster.
+ * @param f the stream
+ * @param header the parsed header
+ * @return whether a valid header was read
+ */
+bool read_header(FILE *f, ppm_header_t *header) {
+    // File type
+    int c1 = getc(f);
+    int c2 = getc(f);
+    if (c1 != 'P') c2 = 0;
+    switch (c2) {
+        case '1': header->type = PPM_ASCII; header->depth = 1; break;
+        case '2': header->type = PPM_ASCII; header->depth = 1; break;
+        case '3': header->type = PPM_ASCII; header->depth = 3; break;
+        case '4': header->type = PPM_RAW;   header->depth = 1; break;
+        case '5': header->type = PPM_RAW;   header->depth = 1; break;
+        case '6': header->type = PPM_RAW;   header->depth = 3; break;
+        case '7': header->type = PPM_RAW;   header->depth = 0; break;
+        default:
+            fprintf(stderr, "PPM reader: unsupported format!\n");
+            return false;
+    }
+    header->format = c2 - '0';
+    header->tupltype[0] = 0;
+    if (header->format == 7) return read_pam_header(f, header);
+
+    // Image width, height and maximum value per component (none for PBM).
+    // The last value is followed by a single whitespace character, consumed by read_uint.
+    if (!read_uint(f, &header->width)) return false;
+    if (!read_uint(f, &header->height)) return false;
+    if (header->format == 1 || header->format == 4)
+        header->maxval = 1;
+    else if (!read_uint(f, &header->maxval))
+        return false;
+    return check_header(header);
+}
+
+/**
+ * Format a PPM or PGM header.
+ * @param buf where to store the header (at least MAX_HEADER_LENGTH bytes)
+ * @param type the type of the file (binary or ASCII)
+ * @param depth the number of components per pixel: 1 (PGM) or 3 (PPM)
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param maxval the maximum value of a component
+ * @return the length of the header
+ */
+int format_header(char *buf, enum PPM_TYPE type, int depth, int width, int height, int maxval) {
+    const char *magic = depth == 1 ? (type == PPM_RAW ? "P5" : "P2") : (type == PPM_RAW ? "P6" : "P3");
+    return sprintf(buf, "%s\n%d %d\n%d\n", magic, width, height, maxval);
+}
+
+/**
+ * Read components with at most 1 byte per component (maximum value up to 255),
+ * scaling them from 0..maxval to 0..255.
+ * @param f the stream, positioned on the raster
+ * @param header the header of the image
+ * @param data where to store the components
+ * @param count the number of components to read
+ * @return whether all components were read
+ */
+bool read_samples(FILE *f, ppm_header_t *header, uint8_t *data, size_t count) {
+    if (header->maxval > 255) {
+        fprintf(stderr, "PPM reader: doesn't support more than 1 byte per component!\n");
+        return false;
+    }
+
+    if (header->type == PPM_ASCII) {
+        // ASCII encoded, scaled through a lookup table
+        uint8_t lut[256];
+        make_scale_lut(lut, header->maxval, 255);
+        for (size_t i = 0; i < count; i++) {
+            unsigned int v;
+            if (!read_uint(f, &v) || v > header->maxval) return false;
+            data[i] = lut[v];
+        }
+    }
+    else {
+        // Binary encoded
+        if (fread(data, 1, count, f) != count) return false;
+        if (header->maxval != 255)
+            scale8(data, data, count, header->maxval, 255);
+    }
+    return true;
+}
+
+/**
+ * Read components with up to 2 bytes per component (maximum value up to 65535).
+ * The components are stored as is (not scaled).
+ * @param f the stream, positioned on the raster
+ * @param header the header of the image
+ * @param data where to store the components
+ * @param count the number of components to read
+ * @return whether all components were read
+ */
+bool read_samples16(FILE *f, ppm_header_t *header, uint16_t *data, size_t count) {
+    if (header->type == PPM_ASCII) {
+        for (size_t i = 0; i < count; i++) {
+            unsigned int v;
+            if (!read_uint(f, &v) || v > header->maxval) return false;
+            data[i] = v;
+        }
+    }
+    else if (header->maxval > 255) {
+        // 2 bytes per component, most significant byte first
+        if (fread(data, sizeof(uint16_t), count, f) != count) return false;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        swap_bytes16(data, count);
+#endif
+    }
+    else {
+        // 1 byte per component: read into the second half of the storage and widen in
+        // place, front to back (a component is always read before being overwritten)
+        uint8_t *bytes = (uint8_t *)data + count;
+        if (fread(bytes, 1, count, f) != count) return false;
+        for (size_t i = 0; i < count; i++)
+            data[i] = bytes[i];
+    }
+    return true;
+}
+
+/**
+ * Write 8-bit components, scaling them from 0..255 to 0..maxval.
+ * @param f the stream, positioned after the header
+ * @param type the type of the file (binary or ASCII)
+ * @param data the components to write
+ * @param count the number of components
+ * @param maxval the maximum value of a component in the file (1 to 255)
+ * @return whether all components were written
+ */
+bool write_samples(FILE *f, enum PPM_TYPE type, const uint8_t *data, size_t count, int maxval) {
+    if (type == PPM_RAW && maxval == 255)
+        return fwrite(data, 1, count, f) == count;
+
+    // Components are scaled chunk by chunk into a temporary buffer if needed
+    uint8_t *buf = NULL;
+    if (maxval != 255) {
+        buf = malloc(CHUNK_SIZE);
+        if (!buf) return false;
+    }
+
+    bool ok = true;
+    for (size_t start = 0; ok && start < count; start += CHUNK_SIZE) {
+        size_t n = count - start < CHUNK_SIZE ? count - start : CHUNK_SIZE;
+        const uint8_t *chunk = data + start;
+        if (buf) {
+            scale8(chunk, buf, n, 255, maxval);
+            chunk = buf;
+        }
+
+        if (type == PPM_RAW) {
+            ok = fwrite(chunk, 1, n, f) == n;
+        }
+        else {
+            // CHUNK_SIZE being a multiple of 15, line breaks don't depend on chunks
+            for (size_t i = 0; i < n; i++) {
+                fprintf(f, "%d ", chunk[i]);
+                if ((i + 1) % 15 == 0)  // New line every 15 components (max 70 characters/line)
+                    fprintf(f, "\n");
+            }
+        }
+    }
+    // Terminate the raster so that a following image starts on its own line
+    if (type == PPM_ASCII && count % 15 != 0) fprintf(f, "\n");
+
+    free(buf);
+    return ok && !ferror(f);
+}
+
+/**
+ * Write components with up to 2 bytes per component. Binary files use 2 bytes per
+ * component (most significant first) when maxval is greater than 255, 1 byte otherwise.
+ * @param f the stream, positioned after the header
+ * @param type the type of the file (binary or ASCII)
+ * @param data the components to write
+ * @param count the number of components
+ * @param maxval the maximum value of a component in the file (1 to 65535)
+ * @return whether all components were written
+ */
+bool write_samples16(FILE *f, enum PPM_TYPE type, const uint16_t *data, size_t count, int maxval) {
+    if (type == PPM_ASCII) {
+        for (size_t i = 0; i < count; i++) {
+            fprintf(f, "%d ", data[i]);
+            if ((i + 1) % 9 == 0)  // New line every 9 components (max 70 characters/line)
+                fprintf(f, "\n");
+        }
+        if (count % 9 != 0) fprintf(f, "\n");
+        return !ferror(f);
+    }
+
+    // Components are converted to the file's representation chunk by chunk
+    uint16_t *buf = malloc(CHUNK_SIZE * sizeof(uint16_t));
+    if (!buf) return false;
+    bool ok = true;
+    for (size_t start = 0; ok && start < count; start += CHUNK_SIZE) {
+        size_t n = count - start < CHUNK_SIZE ? count - start : CHUNK_SIZE;
+        if (maxval > 255) {
+            memcpy(buf, data + start, n * sizeof(uint16_t));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            swap_bytes16(buf, n);
+#endif
+            ok = fwrite(buf, sizeof(uint16_t), n, f) == n;
+        }
+        else {
+            uint8_t *bytes = (uint8_t *)buf;
+            for (size_t i = 0; i < n; i++)
+                bytes[i] = data[start + i];
+            ok = fwrite(bytes, 1, n, f) == n;
+        }
+    }
+    free(buf);
+    return ok && !ferror(f);
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Validate the size and maximum value of a parsed header.
+static bool check_header(ppm_header_t *header) {
+    if (header->width == 0 || header->height == 0 || header->width > INT_MAX / header->height) {
+        fprintf(stderr, "PPM reader: invalid image size!\n");
+        return false;
+    }
+    if (header->maxval == 0 || header->maxval > 65535) {
+        fprintf(stderr, "PPM reader: invalid maximum value!\n");
+        return false;
+    }
+    return true;
+}
+
+// Parse the lines of a PAM header following the magic number, up to and including ENDHDR.
+static bool read_pam_header(FILE *f, ppm_header_t *header) {
+    bool seen[4] = { false };   // WIDTH, HEIGHT, DEPTH, MAXVAL
+    unsigned int depth;
+
+    while (1) {
+        // Keyword, at the start of a line
+        char keyword[MAX_KEYWORD_LENGTH+1];
+        int len = 0, c;
+        if (skip_space(f) == EOF) return false;
+        while ((c = getc(f)) != EOF && !isspace(c))
+            if (len < MAX_KEYWORD_LENGTH) keyword[len++] = c;
+        keyword[len] = 0;
+
+        if (strcmp(keyword, "ENDHDR") == 0) {
+            // The raster starts after the end of the line
+            while (c != EOF && c != '\n') c = getc(f);
+            break;
+        }
+        else if (strcmp(keyword, "TUPLTYPE") == 0) {
+            // The rest of the line; several TUPLTYPE lines are concatenated
+            size_t n = strlen(header->tupltype);
+            if (n > 0 && n < MAX_TUPLTYPE_LENGTH) header->tupltype[n++] = ' ';
+            while (c == ' ' || c == '\t') c = getc(f);
+            while (c != EOF && c != '\n') {
+                if (n < MAX_TUPLTYPE_LENGTH) header->tupltype[n++] = c;
+                c = getc(f);
+            }
+            while (n > 0 && isspace((unsigned char)header->tupltype[n-1])) n--;
+            header->tupltype[n] = 0;
+        }
+        else {
+            static const char *names[] = { "WIDTH", "HEIGHT", "DEPTH", "MAXVAL" };
+            unsigned int *values[] = { &header->width, &header->height, &depth, &header->maxval };
+            int k = 0;
+            while (k < 4 && strcmp(keyword, names[k]) != 0) k++;
+            if (k == 4 || c == '\n' || !read_uint(f, values[k])) {
+                fprintf(stderr, "PAM reader: invalid header!\n");
+                return false;
+            }
+            seen[k] = true;
+        }
+    }
+
+    if (!seen[0] || !seen[1] || !seen[2] || !seen[3] || depth == 0 || depth > 255) {
+        fprintf(stderr, "PAM reader: invalid header!\n");
+        return false;
+    }
+    header->depth = depth;
+    return check_header(header);
+}
@@ -0,0 +1,42 @@
+/**
+ * @file pnm.h
+ * @date 16 Oct 2026
+ * @brief Internal routines shared by the readers and writers of the netpbm formats.
+ *
+ * Not part of the public interface.
+ */
+
+#ifndef PNM_H
+#define PNM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ppm.h"
+
+// Large enough for any header written by format_header
+#define MAX_HEADER_LENGTH 64
+
+// Maximum length of a PAM tuple type
+#define MAX_TUPLTYPE_LENGTH 63
+
+typedef struct {
+    int format;     // digit of the magic number: 1 to 7 (P1 to P7)
+    enum PPM_TYPE type;
+    int depth;      // number of components per pixel: 1 (PBM, PGM), 3 (PPM) or any (PAM)
+    unsigned int width;
+    unsigned int height;
+    unsigned int maxval;    // always 1 for PBM
+    char tupltype[MAX_TUPLTYPE_LENGTH+1];   // PAM only, empty if not specified
+} ppm_header_t;
+
+extern int skip_space(FILE *f);
+extern bool read_uint(FILE *f, unsigned int *val);
+extern bool read_header(FILE *f, ppm_header_t *header);
+extern int format_header(char *buf, enum PPM_TYPE type, int depth, int width, int height, int maxval);
+extern bool read_samples(FILE *f, ppm_header_t *header, uint8_t *data, size_t count);
+extern bool read_samples16(FILE *f, ppm_header_t *header, uint16_t *data, size_t count);
+extern bool write_samples(FILE *f, enum PPM_TYPE type, const uint8_t *data, size_t count, int maxval);
+extern bool write_samples16(FILE *f, enum PPM_TYPE type, const uint16_t *data, size_t count, int maxval);
+
+#endif
@@ -14,21 +14,66 @@
  * convert -compress none image.jpg output.ppm
  */
 
+#define _GNU_SOURCE     // copy_file_range
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <pthread.h>
 #include "ppm.h"
+#include "pnm.h"
 
+// Buffer size of the userspace fallback used by copy_ppm
+#define COPY_BUFFER_SIZE (1 << 20)
+
+// Maximum number of threads of write_ppm_parallel
+#define MAX_WRITE_THREADS 64
+
+// The binary raster is read and written in bulk straight from/to pix1d
+_Static_assert(sizeof(pixel_t) == 3, "pixel_t must be packed as 3 bytes");
+_Static_assert(sizeof(pixel16_t) == 6, "pixel16_t must be packed as 6 bytes");
+
+struct ppm_reader_st {
+    FILE *f;
+    bool owned;     // whether f must be closed (false for stdin)
+    bool error;     // whether an invalid or truncated image was encountered
+};
+
+// An image whose pixels live in a memory mapped P6 file (see map_ppm)
 typedef struct {
-    enum PPM_TYPE type;
-    unsigned int width;
-    unsigned int height;
-    unsigned int maxval;
-    long data_offset;   // offset in the file of the image data (pixels)
-} ppm_header_t;
+    img_t img;      // must be the first member: map_ppm returns a pointer to it
+    void *base;     // start of the mapping (the header)
+    size_t length;  // length of the mapping
+} mapped_img_t;
 
-static void readline(FILE *f, char *line, int max_line_length);
-static ppm_header_t *load_header(char *filename);
+// Band of rows written by one thread of write_ppm_parallel
+typedef struct {
+    int fd;
+    const uint8_t *data;
+    size_t length;
+    off_t offset;
+    bool ok;
+} band_t;
+
+struct ppm_writer_st {
+    FILE *f;
+    bool owned;     // whether f must be closed (false for stdout)
+    bool error;     // whether a write failed
+};
+
+static img_t *read_img(FILE *f, bool *error);
+static img_t *read_raster(FILE *f, ppm_header_t *header);
+static img16_t *read_img16(FILE *f);
+static bool write_img(FILE *f, img_t *img, enum PPM_TYPE type, int maxval);
+static bool write_img16(FILE *f, img16_t *img, enum PPM_TYPE type);
+static void *write_band(void *arg);
+static bool copy_range(int in, off_t offset, int out, size_t length);
+static bool sync_dir(char *filename);
 
 /**
  * Allocate the memory for an image of size width*height
@@ -57,7 +102,7 @@ img_t *alloc_img(int width, int height) {
     }
 
     for (int i = 0; i < height; i++)
-        img->pix2d[i] = img->pix1d + width*i;
+        img->pix2d[i] = img->pix1d + (size_t)width * i;
 
     return img;
 }
@@ -72,6 +117,50 @@ void free_img(img_t *img) {
     free(img);
 }
 
+/**
+ * Allocate the memory for a 48-bit image of size width*height
+ * @param width the width of the image to allocate
+ * @param height the height of the image to allocate
+ * @param maxval the maximum value of a component (1 to 65535)
+ * @return a pointer to the allocated image or NULL if the allocation failed
+ */
+img16_t *alloc_img16(int width, int height, int maxval) {
+    img16_t *img = malloc(sizeof(img16_t));
+
+    if (!img) return NULL;
+
+    img->width = width;
+    img->height = height;
+    img->maxval = maxval;
+    img->pix1d = malloc(sizeof(pixel16_t) * width * height);
+    if (!img->pix1d) {
+        free(img);
+        return NULL;
+    }
+
+    img->pix2d = malloc(sizeof(pixel16_t*) * height);
+    if (!img->pix2d) {
+        free(img->pix1d);
+        free(img);
+        return NULL;
+    }
+
+    for (int i = 0; i < height; i++)
+        img->pix2d[i] = img->pix1d + (size_t)width * i;
+
+    return img;
+}
+
+/**
+ * Free an allocated 48-bit image.
+ * @param img a pointer to the image to free
+ */
+void free_img16(img16_t *img) {
+    free(img->pix1d);
+    free(img->pix2d);
+    free(img);
+}
+
 /**
  * Write a 24-bit RGB PPM file (either ASCII P3 type or binary P6 type).
  * @param filename (absolute or relative path) of the image to write
@@ -80,146 +169,616 @@ void free_img(img_t *img) {
  * @return boolean value indicating whether the write succeeded or not
  */
 bool write_ppm(char *filename, img_t *img, enum PPM_TYPE type) {
+    return write_ppm_maxval(filename, img, type, 255);
+}
+
+/**
+ * Write a 24-bit RGB PPM file (either ASCII P3 type or binary P6 type) with a maximum value
+ * per component lower than 255. Components are scaled from 0..255 to 0..maxval.
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @param maxval the maximum value of a component in the file (1 to 255)
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_ppm_maxval(char *filename, img_t *img, enum PPM_TYPE type, int maxval) {
+    if (maxval < 1 || maxval > 255) return false;
+
     FILE *f = fopen(filename, "w");
     if (!f) return false;
 
+    bool ok = write_img(f, img, type, maxval);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+/**
+ * Atomically write a 24-bit RGB PPM file (either ASCII P3 type or binary P6 type).
+ * The image is written to a temporary file in the target's directory, which is then renamed
+ * into place: readers never observe a partially written file and a crash never leaves a
+ * truncated one behind. The temporary file is preallocated whenever its size is known (P6).
+ * The new file inherits the mode of the file it replaces, if any, or gets mode 0644.
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @param sync whether to fsync the file and its directory, so that the write is durable
+ *        once the routine returns
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_ppm_atomic(char *filename, img_t *img, enum PPM_TYPE type, bool sync) {
+    // Temporary file ".<name>.XXXXXX" in the same directory, so that rename is atomic
+    char *tmp = malloc(strlen(filename) + 9);
+    if (!tmp) return false;
+    char *base = strrchr(filename, '/');
+    base = base ? base + 1 : filename;
+    int dirlen = base - filename;
+    sprintf(tmp, "%.*s.%s.XXXXXX", dirlen, filename, base);
+
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        free(tmp);
+        return false;
+    }
+
+    struct stat st;
+    if (fchmod(fd, stat(filename, &st) == 0 ? st.st_mode & 07777 : 0644) != 0) goto error1;
+
     if (type == PPM_RAW) {
-        fprintf(f, "%s\n%d %d\n255\n", "P6", img->width, img->height);
-        // Write image content
-        for (int i = 0; i < img->width * img->height; i++) {
-            pixel_t *p = &img->pix1d[i];
-            fwrite(&p->r, sizeof(p->r), 1, f);
-            fwrite(&p->g, sizeof(p->g), 1, f);
-            fwrite(&p->b, sizeof(p->b), 1, f);
-        }
+        char header[MAX_HEADER_LENGTH];
+        off_t size = format_header(header, type, 3, img->width, img->height, 255) +
+            (off_t)sizeof(pixel_t) * img->width * img->height;
+        // Not all file systems support preallocation: only a lack of space is an error
+        if (posix_fallocate(fd, 0, size) == ENOSPC) goto error1;
     }
-    else {
-        fprintf(f, "%s\n%d %d\n255\n", "P3", img->width, img->height);
-        // Write image content
-        int count = 0;
-        for (int i = 0; i < img->width * img->height; i++) {
-            pixel_t *p = &img->pix1d[i];
-            fprintf(f, "%d %d %d ", p->r, p->g, p->b);
-            if (++count % 5 == 0)  // New line every 5 pixels (max 70 characters/line)
-                fprintf(f, "\n");
-        }
+
+    FILE *f = fdopen(fd, "w");
+    if (!f) goto error1;
+    if (!write_img(f, img, type, 255)) goto error2;
+    if (fflush(f) != 0) goto error2;
+    if (sync && fsync(fd) != 0) goto error2;
+    if (fclose(f) != 0) goto error3;
+
+    if (rename(tmp, filename) != 0) goto error3;
+    if (sync && !sync_dir(filename)) {
+        free(tmp);
+        return false;
     }
 
-    fclose(f);
+    free(tmp);
     return true;
+
+error2:
+    fclose(f);
+    goto error3;
+
+error1:
+    close(fd);
+
+error3:
+    unlink(tmp);
+    free(tmp);
+    return false;
+}
+
+/**
+ * Write a binary (P6) PPM file using several threads.
+ * Every row has the same size in the file, so the raster is split into bands of rows,
+ * each written concurrently at its own offset with pwrite. This can saturate storage
+ * bandwidth that a single sequential stream cannot.
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @param nthreads the number of threads (bands) to use, at most MAX_WRITE_THREADS and the
+ *        number of rows
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_ppm_parallel(char *filename, img_t *img, int nthreads) {
+    // An empty image is just a header
+    if (img->height == 0) return write_ppm(filename, img, PPM_RAW);
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > MAX_WRITE_THREADS) nthreads = MAX_WRITE_THREADS;
+    if (nthreads > img->height) nthreads = img->height;
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return false;
+
+    char header[MAX_HEADER_LENGTH];
+    int header_length = format_header(header, PPM_RAW, 3, img->width, img->height, 255);
+    size_t row_length = sizeof(pixel_t) * img->width;
+    off_t size = header_length + (off_t)row_length * img->height;
+    bool ok = pwrite(fd, header, header_length, 0) == header_length;
+    // Size the file up front so that the bands don't extend it concurrently
+    if (ok && ftruncate(fd, size) != 0) ok = false;
+
+    band_t bands[nthreads];
+    pthread_t threads[nthreads];
+    int started = 0;
+    for (int i = 0; ok && i < nthreads; i++) {
+        int first = (long)img->height * i / nthreads;
+        int last = (long)img->height * (i + 1) / nthreads;
+        bands[i].fd = fd;
+        bands[i].data = (const uint8_t *)img->pix2d[first];
+        bands[i].length = row_length * (last - first);
+        bands[i].offset = header_length + (off_t)row_length * first;
+        // The calling thread writes the last band itself
+        if (i == nthreads - 1) {
+            write_band(&bands[i]);
+            ok = bands[i].ok;
+        }
+        else if (pthread_create(&threads[i], NULL, write_band, &bands[i]) == 0) {
+            started++;
+        }
+        else {
+            ok = false;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        if (!bands[i].ok) ok = false;
+    }
+
+    if (close(fd) != 0) ok = false;
+    return ok;
+}
+
+/**
+ * Create a binary (P6) PPM file of the given size and map it into memory.
+ * The file is sized and preallocated up front; the returned image's pixels are the file's
+ * raster, so that several threads can fill distinct rows in parallel and the kernel takes
+ * care of flushing the pages to disk. The pixels are initially black.
+ * The image must be released with unmap_ppm, never with free_img.
+ * @param filename (absolute or relative path) of the image to create
+ * @param width the width of the image
+ * @param height the height of the image
+ * @return a pointer to the mapped image or NULL if an error occured
+ */
+img_t *map_ppm(char *filename, int width, int height) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    mapped_img_t *mimg = malloc(sizeof(mapped_img_t));
+    if (!mimg) return NULL;
+    img_t *img = &mimg->img;
+    img->width = width;
+    img->height = height;
+    img->pix2d = malloc(sizeof(pixel_t*) * height);
+    if (!img->pix2d) goto error1;
+
+    char header[MAX_HEADER_LENGTH];
+    int header_length = format_header(header, PPM_RAW, 3, width, height, 255);
+    mimg->length = header_length + sizeof(pixel_t) * width * height;
+
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) goto error2;
+    if (ftruncate(fd, mimg->length) != 0) goto error3;
+    // Reserve the blocks so that a full disk can't fault on a page write later on.
+    // Not all file systems support preallocation: only a lack of space is an error.
+    if (posix_fallocate(fd, 0, mimg->length) == ENOSPC) goto error3;
+
+    mimg->base = mmap(NULL, mimg->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mimg->base == MAP_FAILED) goto error3;
+    close(fd);  // the mapping keeps the file referenced
+
+    memcpy(mimg->base, header, header_length);
+    img->pix1d = (pixel_t *)((uint8_t *)mimg->base + header_length);
+    for (int i = 0; i < height; i++)
+        img->pix2d[i] = img->pix1d + (size_t)width * i;
+
+    return img;
+
+error3:
+    close(fd);
+    unlink(filename);
+
+error2:
+    free(img->pix2d);
+
+error1:
+    free(mimg);
+    return NULL;
+}
+
+/**
+ * Release an image created by map_ppm. The file is complete once this routine returns.
+ * @param img a pointer to the mapped image
+ * @param sync whether to wait until the pages are written to disk
+ * @return boolean value indicating whether the file was written successfully or not
+ */
+bool unmap_ppm(img_t *img, bool sync) {
+    mapped_img_t *mimg = (mapped_img_t *)img;
+    bool ok = true;
+    if (sync && msync(mimg->base, mimg->length, MS_SYNC) != 0) ok = false;
+    if (munmap(mimg->base, mimg->length) != 0) ok = false;
+    free(img->pix2d);
+    free(mimg);
+    return ok;
 }
 
 /**
  * Load a 24-bit RGB PPM file (either ASCII P3 type or binary P6 type).
  * The routine takes care of allocating the memory for the image.
+ * Files with a maximum value per component lower than 255 are scaled to 0..255.
+ * If the file contains several images, only the first one is loaded.
  * @param filename (absolute or relative path) of the image to load
  * @return a pointer to the loaded image or NULL if an error occured
  */
 img_t *load_ppm(char *filename) {
-    ppm_header_t *header = load_header(filename);
-    if (!header) goto error1;
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
 
-    // Allocate memory for image structure and image data
-    img_t *img = alloc_img(header->width, header->height);
-    if (!img) goto error1;
+    bool error;
+    img_t *img = read_img(f, &error);
+    fclose(f);
+    return img;
+}
 
-    FILE *f = fopen(filename, "r");
-    if (f == NULL) goto error1;
-
-    fseek(f, header->data_offset, SEEK_SET);
-
-    if (header->type == PPM_ASCII) {
-        // Image data in RGB order, ASCII encoded 
-        for (unsigned int i = 0; i < header->width * header->height; i++) {
-            unsigned int r, g, b;
-            int matches = fscanf(f, "%u %u %u", &r, &g, &b);
-            if (matches != 3) goto error2;
-            if (r > header->maxval || g > header->maxval || b > header->maxval) goto error2;
-            pixel_t p = { r, g, b };
-            img->pix1d[i] = p;
+/**
+ * Copy a PPM file into a binary (P6) PPM file with a normalized header (no comments).
+ * When the input is a seekable P6 file with a maximum value of 255, the raster is moved
+ * by the kernel (copy_file_range, or sendfile) without going through userspace, falling
+ * back to large buffered copies. Other inputs are decoded and encoded again.
+ * If the input contains several images, only the first one is copied.
+ * @param input (absolute or relative path) of the image to copy
+ * @param output (absolute or relative path) of the image to write
+ * @return boolean value indicating whether the copy succeeded or not
+ */
+bool copy_ppm(char *input, char *output) {
+    FILE *f = fopen(input, "r");
+    if (!f) return false;
+
+    ppm_header_t header;
+    bool ok = false;
+    if (!read_header(f, &header)) goto out;
+
+    long offset = ftell(f);
+    if (header.format != 6 || header.maxval != 255 || offset < 0) {
+        // No passthrough possible: decode the raster following the header (a pipe can't
+        // be rewound) and encode it again
+        if (header.format != 3 && header.format != 6) {
+            fprintf(stderr, "PPM reader: unsupported format!\n");
+            goto out;
         }
+        img_t *img = read_raster(f, &header);
+        if (img) {
+            ok = write_ppm(output, img, PPM_RAW);
+            free_img(img);
+        }
+        goto out;
+    }
+
+    int out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) goto out;
+    char buf[MAX_HEADER_LENGTH];
+    int header_length = format_header(buf, PPM_RAW, 3, header.width, header.height, 255);
+    size_t length = sizeof(pixel_t) * header.width * header.height;
+    ok = write(out, buf, header_length) == header_length &&
+        copy_range(fileno(f), offset, out, length);
+    if (close(out) != 0) ok = false;
+
+out:
+    fclose(f);
+    return ok;
+}
+
+/**
+ * Open a PPM file or stream containing any number of concatenated images.
+ * The images are read sequentially with next_ppm, without seeking, so pipes are supported.
+ * @param filename (absolute or relative path) of the file to read, or "-" for stdin
+ * @return a pointer to the reader or NULL if an error occured
+ */
+ppm_reader_t *open_ppm_reader(char *filename) {
+    ppm_reader_t *reader = calloc(1, sizeof(ppm_reader_t));
+    if (!reader) return NULL;
+
+    if (strcmp(filename, "-") == 0) {
+        reader->f = stdin;
     }
     else {
-        // Image data in RGB order, binary encoded 
-        for (unsigned int i = 0; i < header->width * header->height; i++) {
-            fread(&img->pix1d[i].r, 1, 1, f);
-            fread(&img->pix1d[i].g, 1, 1, f);
-            fread(&img->pix1d[i].b, 1, 1, f);
+        reader->f = fopen(filename, "r");
+        if (!reader->f) {
+            free(reader);
+            return NULL;
         }
+        reader->owned = true;
     }
+    return reader;
+}
+
+/**
+ * Read the next image of a PPM stream.
+ * The routine takes care of allocating the memory for the image.
+ * @param reader the reader returned by open_ppm_reader
+ * @return a pointer to the image, or NULL when the end of the stream is reached or an
+ *         error occured (close_ppm_reader tells which)
+ */
+img_t *next_ppm(ppm_reader_t *reader) {
+    if (reader->error) return NULL;
+    return read_img(reader->f, &reader->error);
+}
+
+/**
+ * Close a PPM reader.
+ * @param reader the reader to close
+ * @return true if the whole stream was read without error, false otherwise
+ */
+bool close_ppm_reader(ppm_reader_t *reader) {
+    bool ok = !reader->error && !ferror(reader->f);
+    if (reader->owned) fclose(reader->f);
+    free(reader);
+    return ok;
+}
+
+/**
+ * Open a PPM file or stream to write any number of images to it, one after the other.
+ * @param filename (absolute or relative path) of the file to write, or "-" for stdout
+ * @param append whether to append the images to an existing file instead of truncating it
+ * @return a pointer to the writer or NULL if an error occured
+ */
+ppm_writer_t *open_ppm_writer(char *filename, bool append) {
+    ppm_writer_t *writer = calloc(1, sizeof(ppm_writer_t));
+    if (!writer) return NULL;
 
-    free(header);
+    if (strcmp(filename, "-") == 0) {
+        writer->f = stdout;
+    }
+    else {
+        writer->f = fopen(filename, append ? "a" : "w");
+        if (!writer->f) {
+            free(writer);
+            return NULL;
+        }
+        writer->owned = true;
+    }
+    return writer;
+}
+
+/**
+ * Append an image to a PPM stream.
+ * @param writer the writer returned by open_ppm_writer
+ * @param img a pointer to the image to write
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool append_ppm(ppm_writer_t *writer, img_t *img, enum PPM_TYPE type) {
+    if (!write_img(writer->f, img, type, 255)) writer->error = true;
+    return !writer->error;
+}
+
+/**
+ * Append an image produced band by band to a PPM stream, without ever holding it whole:
+ * the producer fills a band of rows, which is written before the next one is requested.
+ * @param writer the writer returned by open_ppm_writer
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @param produce the producer of the rows, called for successive bands
+ * @param arg the argument passed to the producer
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool append_ppm_rows(ppm_writer_t *writer, int width, int height, enum PPM_TYPE type,
+                     ppm_rows_t produce, void *arg) {
+    size_t row_length = sizeof(pixel_t) * width;
+    int nrows = row_length > 0 && row_length < COPY_BUFFER_SIZE ? COPY_BUFFER_SIZE / row_length : 1;
+    // Bands of a multiple of 5 rows hold a multiple of 15 components, so that the line
+    // breaks of ASCII files don't depend on the bands
+    if (nrows >= 5) nrows -= nrows % 5;
+    pixel_t *rows = malloc(row_length * nrows + 1);
+    if (!rows) {
+        writer->error = true;
+        return false;
+    }
+
+    char header[MAX_HEADER_LENGTH];
+    format_header(header, type, 3, width, height, 255);
+    if (fputs(header, writer->f) == EOF) writer->error = true;
+    for (int j = 0; !writer->error && j < height; j += nrows) {
+        int n = height - j < nrows ? height - j : nrows;
+        produce(arg, rows, j, n);
+        if (!write_samples(writer->f, type, (uint8_t *)rows, row_length * n, 255)) writer->error = true;
+    }
+
+    free(rows);
+    return !writer->error;
+}
+
+/**
+ * Close a PPM writer, flushing any buffered data.
+ * @param writer the writer to close
+ * @return true if all images were written successfully, false otherwise
+ */
+bool close_ppm_writer(ppm_writer_t *writer) {
+    bool ok = !writer->error;
+    if (writer->owned) {
+        if (fclose(writer->f) != 0) ok = false;
+    }
+    else if (fflush(writer->f) != 0) {
+        ok = false;
+    }
+    free(writer);
+    return ok;
+}
+
+/**
+ * Load a PPM file (either ASCII P3 type or binary P6 type) with up to 16 bits per component.
+ * Components are stored as is (not scaled), along with the maximum value of the file.
+ * The routine takes care of allocating the memory for the image.
+ * @param filename (absolute or relative path) of the image to load
+ * @return a pointer to the loaded image or NULL if an error occured
+ */
+img16_t *load_ppm16(char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+
+    img16_t *img = read_img16(f);
     fclose(f);
     return img;
+}
 
-error2:
-    fclose(f);
+/**
+ * Write a PPM file (either ASCII P3 type or binary P6 type) with up to 16 bits per component.
+ * The image's maximum value is written in the header; binary files use 2 bytes per
+ * component (big endian) when it is greater than 255, 1 byte otherwise.
+ * @param filename (absolute or relative path) of the image to write
+ * @param img a pointer to the image to write
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @return boolean value indicating whether the write succeeded or not
+ */
+bool write_ppm16(char *filename, img16_t *img, enum PPM_TYPE type) {
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
 
-error1:
-    free(header);
-    return NULL;
+    bool ok = write_img16(f, img, type);
+    if (fclose(f) != 0) ok = false;
+    return ok;
 }
 
 // ====================================================================================================
 // Private functions
 // ====================================================================================================
 
-// Read a line (reads up to max_line_length chars) while skipping comments (lines starting with '#').
-static void readline(FILE *f, char *line, int max_line_length) {
-    static int line_nb = 0;
-    while (1) {
-        line_nb++;
-        char fmt[16];
-        sprintf(fmt, "%%%d[^\n]", max_line_length);
-        fscanf(f, fmt, line);
-        fscanf(f, "\n");
-        if (line[0] != '#') break;
+// Read the next image from a stream.
+// Return NULL with *error set to false if the end of the stream was reached before any image.
+static img_t *read_img(FILE *f, bool *error) {
+    *error = false;
+    if (skip_space(f) == EOF) return NULL;
+    *error = true;
+
+    ppm_header_t header;
+    if (!read_header(f, &header)) return NULL;
+    if (header.format != 3 && header.format != 6) {
+        fprintf(stderr, "PPM reader: unsupported format!\n");
+        return NULL;
     }
+
+    img_t *img = read_raster(f, &header);
+    if (img) *error = false;
+    return img;
 }
 
-// Parse a PPM header.
-static ppm_header_t *load_header(char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (f == NULL) return NULL;
+// Read the raster of a PPM image (P3 or P6) whose header was just read from a stream.
+static img_t *read_raster(FILE *f, ppm_header_t *header) {
+    // Allocate memory for image structure and image data
+    img_t *img = alloc_img(header->width, header->height);
+    if (!img) return NULL;
 
-    ppm_header_t *header = calloc(1, sizeof(ppm_header_t));
+    // Image data in RGB order
+    if (!read_samples(f, header, (uint8_t *)img->pix1d, (size_t)3 * header->width * header->height)) {
+        free_img(img);
+        return NULL;
+    }
+    return img;
+}
 
-    const int MAX_LENGTH = 1024;
-    char line[MAX_LENGTH+1];
+// Read an image with up to 16 bits per component from a stream.
+static img16_t *read_img16(FILE *f) {
+    ppm_header_t header;
+    if (!read_header(f, &header)) return NULL;
+    if (header.format != 3 && header.format != 6) {
+        fprintf(stderr, "PPM reader: unsupported format!\n");
+        return NULL;
+    }
 
-    // PPM file type: either P3 or P6
-    readline(f, line, MAX_LENGTH);
-    if (strcmp("P3", line) == 0) {
-        header->type = PPM_ASCII;
+    img16_t *img = alloc_img16(header.width, header.height, header.maxval);
+    if (!img) return NULL;
+
+    if (!read_samples16(f, &header, (uint16_t *)img->pix1d, (size_t)3 * header.width * header.height)) {
+        free_img16(img);
+        return NULL;
     }
-    else if (strcmp("P6", line) == 0) {
-        header->type = PPM_RAW;
+    return img;
+}
+
+// Write an image to a stream, scaling the components to 0..maxval.
+static bool write_img(FILE *f, img_t *img, enum PPM_TYPE type, int maxval) {
+    char header[MAX_HEADER_LENGTH];
+    format_header(header, type, 3, img->width, img->height, maxval);
+    fputs(header, f);
+    return write_samples(f, type, (uint8_t *)img->pix1d, (size_t)3 * img->width * img->height, maxval);
+}
+
+// Write an image with up to 16 bits per component to a stream.
+static bool write_img16(FILE *f, img16_t *img, enum PPM_TYPE type) {
+    char header[MAX_HEADER_LENGTH];
+    format_header(header, type, 3, img->width, img->height, img->maxval);
+    fputs(header, f);
+    return write_samples16(f, type, (uint16_t *)img->pix1d, (size_t)3 * img->width * img->height,
+        img->maxval);
+}
+
+// Thread writing a band of rows at its offset in the file, handling short writes.
+static void *write_band(void *arg) {
+    band_t *band = arg;
+    const uint8_t *data = band->data;
+    size_t length = band->length;
+    off_t offset = band->offset;
+
+    band->ok = true;
+    while (length > 0) {
+        ssize_t n = pwrite(band->fd, data, length, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            band->ok = false;
+            break;
+        }
+        data += n;
+        length -= n;
+        offset += n;
     }
-    else {
-        fprintf(stderr, "PPM reader: unsupported format!\n");
-        goto error;
+    return NULL;
+}
+
+// Copy length bytes from offset in file descriptor in to the current position of out,
+// using the fastest mechanism available.
+static bool copy_range(int in, off_t offset, int out, size_t length) {
+    // In-kernel copy between files (may share extents on copy-on-write file systems)
+    while (length > 0) {
+        ssize_t n = copy_file_range(in, &offset, out, NULL, length, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        length -= n;
     }
+    if (length == 0) return true;
 
-    // Image width and height
-    readline(f, line, MAX_LENGTH);
-    int matches = sscanf(line, "%u %u", &header->width, &header->height);
-    if (matches != 2) goto error;
+    // In-kernel copy through the page cache, supported by more file system combinations
+    while (length > 0) {
+        ssize_t n = sendfile(out, in, &offset, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        length -= n;
+    }
+    if (length == 0) return true;
 
-    // Maximum value per component
-    readline(f, line, MAX_LENGTH);
-    matches = sscanf(line, "%u ", &header->maxval);
-    if (matches != 1) goto error;
-    if (header->maxval > 255) {
-        fprintf(stderr, "PPM reader: doesn't support more than 1 byte per component!\n");
-        goto error;
+    // Userspace copy with a large buffer
+    uint8_t *buf = malloc(COPY_BUFFER_SIZE);
+    if (!buf) return false;
+    while (length > 0) {
+        ssize_t n = pread(in, buf, length < COPY_BUFFER_SIZE ? length : COPY_BUFFER_SIZE, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;  // truncated input
+        for (ssize_t done = 0; done < n; ) {
+            ssize_t w = write(out, buf + done, n - done);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) {
+                free(buf);
+                return false;
+            }
+            done += w;
+        }
+        offset += n;
+        length -= n;
     }
+    free(buf);
+    return length == 0;
+}
 
-    header->data_offset = ftell(f);
-    fclose(f);
-    return header;
+// Flush the directory entry of a file to disk, making a preceding rename durable.
+static bool sync_dir(char *filename) {
+    char *slash = strrchr(filename, '/');
+    char *dir = slash ? strndup(filename, slash == filename ? 1 : slash - filename) : strdup(".");
+    if (!dir) return false;
 
-error:
-    free(header);
-    fclose(f);
-    return NULL;
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    free(dir);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
 }
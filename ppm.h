@@ -5,6 +5,9 @@
  * @brief Routines to read and write PPM files.
  */
 
+#ifndef PPM_H
+#define PPM_H
+
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -32,6 +35,33 @@ typedef struct img_st {
     pixel_t **pix2d;
 } img_t;
 
+/**
+ * Store a 48-bit pixel (16-bit per component).
+ * @param r the red component
+ * @param g the green component
+ * @param b the blue component
+ */
+typedef struct pixel16_st {
+    uint16_t r, g, b;
+} pixel16_t;
+
+/**
+ * Structure holding a 48-bit per pixel image.
+ * Component values range from 0 to maxval (at most 65535).
+ * @param width the width of the image
+ * @param height the height of the image
+ * @param maxval the maximum value of a component
+ * @param pix1d accessor to the image pixel data as a 1D array
+ * @param pix2d accessor to the image pixel data as a 2D array [height][width]
+ */
+typedef struct img16_st {
+    int width;
+    int height;
+    int maxval;
+    pixel16_t *pix1d;
+    pixel16_t **pix2d;
+} img16_t;
+
 /**
  * Supported PPM types, either RAW or ASCII.
  */
@@ -40,8 +70,48 @@ enum PPM_TYPE {
     PPM_ASCII
 };
 
+/**
+ * Opaque iterator over the images of a (possibly multi-image) PPM file or stream.
+ */
+typedef struct ppm_reader_st ppm_reader_t;
+
+/**
+ * Opaque writer appending successive images to a single PPM file or stream.
+ */
+typedef struct ppm_writer_st ppm_writer_t;
+
+/**
+ * Producer of the rows of an image written by append_ppm_rows.
+ * @param arg the argument given to append_ppm_rows
+ * @param rows where to store the rows, one after the other
+ * @param first the index of the first row to produce
+ * @param count the number of rows to produce
+ */
+typedef void (*ppm_rows_t)(void *arg, pixel_t *rows, int first, int count);
+
 extern img_t *alloc_img(int width, int height);
 extern void free_img(img_t *img);
 extern img_t *load_ppm(char *filename);
 extern bool write_ppm(char *filename, img_t *img, enum PPM_TYPE);
+extern bool write_ppm_maxval(char *filename, img_t *img, enum PPM_TYPE type, int maxval);
+extern bool write_ppm_atomic(char *filename, img_t *img, enum PPM_TYPE type, bool sync);
+extern bool write_ppm_parallel(char *filename, img_t *img, int nthreads);
+extern bool copy_ppm(char *input, char *output);
+extern img_t *map_ppm(char *filename, int width, int height);
+extern bool unmap_ppm(img_t *img, bool sync);
+
+extern img16_t *alloc_img16(int width, int height, int maxval);
+extern void free_img16(img16_t *img);
+extern img16_t *load_ppm16(char *filename);
+extern bool write_ppm16(char *filename, img16_t *img, enum PPM_TYPE type);
+
+extern ppm_reader_t *open_ppm_reader(char *filename);
+extern img_t *next_ppm(ppm_reader_t *reader);
+extern bool close_ppm_reader(ppm_reader_t *reader);
+extern ppm_writer_t *open_ppm_writer(char *filename, bool append);
+extern bool append_ppm(ppm_writer_t *writer, img_t *img, enum PPM_TYPE type);
+extern bool append_ppm_rows(ppm_writer_t *writer, int width, int height, enum PPM_TYPE type,
+                            ppm_rows_t produce, void *arg);
+extern bool close_ppm_writer(ppm_writer_t *writer);
 
+#endif
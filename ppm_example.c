@@ -10,6 +10,7 @@
 #include <libgen.h>
 #include <string.h>
 #include "ppm.h"
+#include "adjust.h"
 
 /**
  * Display the program's syntaxe.
@@ -55,14 +56,7 @@ int main(int argc, char **argv) {
     }
 
     // Reduce image's first quadrant's brightness intensity
-    for (int j = 0; j < img->height/2; j++) {
-        for (int i = 0; i < img->width/2; i++) {
-            pixel_t *p = &img->pix2d[j][i];
-            p->r /= 2;
-            p->g /= 2;
-            p->b /= 2;
-        }
-    }
+    adjust_brightness(img, 0, 0, img->width/2, img->height/2, 0.5f, 0);
 
     // Write image
     if (!write_ppm(output, img, type)) {
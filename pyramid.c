@@ -0,0 +1,217 @@
+/**
+ * @file pyramid.c
+ * @date 16 Oct 2026
+ * @brief Image pyramids (mipmaps) of successive 2x downsampled levels.
+ *
+ * Each pixel of a level is the rounded average of a 2x2 block of the previous level; on
+ * odd sizes, the last column and row of the previous level are repeated.
+ *
+ * All levels are built in a single pass over the source image, by bands of rows: a band
+ * of the first level is reduced from the source rows, then immediately reduced into the
+ * corresponding band of the second level while still in the cache, and so on. Bands of
+ * the first level have a power of two number of rows, so that every band maps to whole
+ * rows of the following levels, down to the level where it becomes a single row; the
+ * bands are thus independent and run in parallel on the default thread pool (see
+ * parallel.h). The remaining levels, smaller than a band, are reduced afterwards.
+ *
+ * A row is reduced 4 output pixels at a time with SSSE3 when the CPU supports it: shuffles
+ * gather the left and right pixels of each pair of 8 source pixels, which are summed in
+ * 16 bits with those of the next row.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pyramid.h"
+#include "parallel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86
+#endif
+
+// Reduce two rows of width pixels into a row of (width+1)/2 pixels
+typedef void (*reduce_t)(const pixel_t *a, const pixel_t *b, pixel_t *out, int width);
+
+// Arguments of the bands
+typedef struct {
+    img_t *src;
+    pyramid_t *pyr;
+    int band;       // number of rows of the first level in a band, a power of two
+    int depth;      // number of levels built band by band
+    reduce_t reduce;
+} build_t;
+
+static void reduce_rows(build_t *build, int level, int first, int last);
+static void pyramid_bands(void *arg, int first, int last);
+static void reduce_row(const pixel_t *a, const pixel_t *b, pixel_t *out, int width);
+#ifdef HAVE_X86
+static void reduce_row_ssse3(const pixel_t *a, const pixel_t *b, pixel_t *out, int width);
+#endif
+
+/**
+ * Build the pyramid of an image, optionally writing each level to a PPM file.
+ * The routine takes care of allocating the memory for the pyramid.
+ * @param src a pointer to the source image
+ * @param nlevels the number of levels to build, or 0 (or less) for all levels down to 1x1;
+ *        it is limited to the number of levels down to 1x1
+ * @param pattern a printf format of the names of the files receiving the levels, taking
+ *        the level number (1 for the first level, half the size of the source), or NULL
+ * @param type the type of the PPM files (binary or ASCII)
+ * @return a pointer to the pyramid or NULL if an allocation or a write failed
+ */
+pyramid_t *build_pyramid(img_t *src, int nlevels, char *pattern, enum PPM_TYPE type) {
+    int max = 0;
+    size_t npixels = 0, nrows = 0;
+    for (int w = src->width, h = src->height; (w > 1 || h > 1) && (nlevels <= 0 || max < nlevels); max++) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        npixels += (size_t)w * h;
+        nrows += h;
+    }
+
+    pyramid_t *pyr = calloc(1, sizeof(pyramid_t));
+    if (!pyr) return NULL;
+    pyr->nlevels = max;
+    pyr->levels = malloc(sizeof(img_t) * (max > 0 ? max : 1));
+    pyr->pix1d = malloc(sizeof(pixel_t) * (npixels > 0 ? npixels : 1));
+    pyr->rows = malloc(sizeof(pixel_t *) * (nrows > 0 ? nrows : 1));
+    if (!pyr->levels || !pyr->pix1d || !pyr->rows) goto error;
+
+    pixel_t *pixels = pyr->pix1d;
+    pixel_t **rows = pyr->rows;
+    for (int l = 0, w = src->width, h = src->height; l < max; l++) {
+        img_t *level = &pyr->levels[l];
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        level->width = w;
+        level->height = h;
+        level->pix1d = pixels;
+        level->pix2d = rows;
+        for (int j = 0; j < h; j++)
+            rows[j] = pixels + (size_t)w * j;
+        pixels += (size_t)w * h;
+        rows += h;
+    }
+
+    if (max > 0) {
+        build_t build = { src, pyr, 1, 1, reduce_row };
+#ifdef HAVE_X86
+        if (__builtin_cpu_supports("ssse3")) build.reduce = reduce_row_ssse3;
+#endif
+        // A band of the first level reads twice as many source rows
+        int grain = band_grain(2 * sizeof(pixel_t) * src->width);
+        while (build.band * 2 <= grain) {
+            build.band *= 2;
+            if (build.depth < max) build.depth++;
+        }
+        int nbands = (pyr->levels[0].height + build.band - 1) / build.band;
+        parallel_for(default_pool(), 0, nbands, 1, pyramid_bands, &build);
+        for (int l = build.depth; l < max; l++)
+            reduce_rows(&build, l, 0, pyr->levels[l].height);
+    }
+
+    if (pattern) {
+        for (int l = 0; l < max; l++) {
+            char filename[FILENAME_MAX];
+            int n = snprintf(filename, sizeof(filename), pattern, l + 1);
+            if (n < 0 || (size_t)n >= sizeof(filename)) goto error;
+            if (!write_ppm(filename, &pyr->levels[l], type)) goto error;
+        }
+    }
+    return pyr;
+
+error:
+    free_pyramid(pyr);
+    return NULL;
+}
+
+/**
+ * Free a pyramid built by build_pyramid.
+ * @param pyr a pointer to the pyramid to free
+ */
+void free_pyramid(pyramid_t *pyr) {
+    free(pyr->levels);
+    free(pyr->pix1d);
+    free(pyr->rows);
+    free(pyr);
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Reduce rows [first, last[ of a level (clipped to its height) from the previous level.
+static void reduce_rows(build_t *build, int level, int first, int last) {
+    img_t *in = level == 0 ? build->src : &build->pyr->levels[level - 1];
+    img_t *out = &build->pyr->levels[level];
+    if (last > out->height) last = out->height;
+    for (int j = first; j < last; j++) {
+        int y = 2*j + 1 < in->height ? 2*j + 1 : 2*j;
+        build->reduce(in->pix2d[2*j], in->pix2d[y], out->pix2d[j], in->width);
+    }
+}
+
+// Build bands [first, last[ of the first level and the rows of the following levels they
+// map to.
+static void pyramid_bands(void *arg, int first, int last) {
+    build_t *build = arg;
+    for (int k = first; k < last; k++) {
+        for (int l = 0; l < build->depth; l++)
+            reduce_rows(build, l, (k * build->band) >> l, ((k + 1) * build->band) >> l);
+    }
+}
+
+// Reduce two rows into one (scalar version).
+static void reduce_row(const pixel_t *a, const pixel_t *b, pixel_t *out, int width) {
+    int i = 0;
+    for (; 2*i + 1 < width; i++) {
+        const pixel_t *p = a + 2*i, *q = b + 2*i;
+        out[i].r = (p[0].r + p[1].r + q[0].r + q[1].r + 2) >> 2;
+        out[i].g = (p[0].g + p[1].g + q[0].g + q[1].g + 2) >> 2;
+        out[i].b = (p[0].b + p[1].b + q[0].b + q[1].b + 2) >> 2;
+    }
+    // Odd width: the last pixel pairs with itself
+    if (2*i < width) {
+        out[i].r = (a[2*i].r + b[2*i].r + 1) >> 1;
+        out[i].g = (a[2*i].g + b[2*i].g + 1) >> 1;
+        out[i].b = (a[2*i].b + b[2*i].b + 1) >> 1;
+    }
+}
+
+#ifdef HAVE_X86
+// Sum of the left and right pixels of 4 pairs of pixels (24 bytes), in 16 bits.
+__attribute__((target("ssse3")))
+static inline void sum_pairs(const pixel_t *p, __m128i *lo, __m128i *hi) {
+    const __m128i left_lo = _mm_setr_epi8(0, 1, 2, 6, 7, 8, 12, 13, 14, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i left_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, 4, -1, -1, -1, -1);
+    const __m128i right_lo = _mm_setr_epi8(3, 4, 5, 9, 10, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i right_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, 0, 1, 5, 6, 7, -1, -1, -1, -1);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v0 = _mm_loadu_si128((const __m128i *)p);
+    __m128i v1 = _mm_loadl_epi64((const __m128i *)((const uint8_t *)p + 16));
+    __m128i left = _mm_or_si128(_mm_shuffle_epi8(v0, left_lo), _mm_shuffle_epi8(v1, left_hi));
+    __m128i right = _mm_or_si128(_mm_shuffle_epi8(v0, right_lo), _mm_shuffle_epi8(v1, right_hi));
+    *lo = _mm_add_epi16(_mm_unpacklo_epi8(left, zero), _mm_unpacklo_epi8(right, zero));
+    *hi = _mm_add_epi16(_mm_unpackhi_epi8(left, zero), _mm_unpackhi_epi8(right, zero));
+}
+
+// Reduce two rows into one, 4 output pixels (12 bytes) at a time.
+__attribute__((target("ssse3")))
+static void reduce_row_ssse3(const pixel_t *a, const pixel_t *b, pixel_t *out, int width) {
+    const __m128i two = _mm_set1_epi16(2);
+    int i = 0;
+    for (; 2*i + 8 <= width; i += 4) {
+        __m128i a_lo, a_hi, b_lo, b_hi;
+        sum_pairs(a + 2*i, &a_lo, &a_hi);
+        sum_pairs(b + 2*i, &b_lo, &b_hi);
+        __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a_lo, b_lo), two), 2);
+        __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a_hi, b_hi), two), 2);
+        __m128i v = _mm_packus_epi16(lo, hi);
+        _mm_storel_epi64((__m128i *)(out + i), v);
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+        memcpy((uint8_t *)(out + i) + 8, &last, 4);
+    }
+    reduce_row(a + 2*i, b + 2*i, out + i, width - 2*i);
+}
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file pyramid.h
+ * @date 16 Oct 2026
+ * @brief Image pyramids (mipmaps) of successive 2x downsampled levels.
+ */
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include "ppm.h"
+
+/**
+ * Pyramid of images, each level half the size of the previous one (rounded up).
+ * The pixels of all levels are stored one level after the other in a single allocation.
+ * @param nlevels the number of levels
+ * @param levels the levels: levels[i] is the source image downsampled by 2^(i+1)
+ * @param pix1d the pixels of all the levels
+ * @param rows the row pointers of all the levels
+ */
+typedef struct pyramid_st {
+    int nlevels;
+    img_t *levels;
+    pixel_t *pix1d;
+    pixel_t **rows;
+} pyramid_t;
+
+extern pyramid_t *build_pyramid(img_t *src, int nlevels, char *pattern, enum PPM_TYPE type);
+extern void free_pyramid(pyramid_t *pyr);
+
+#endif
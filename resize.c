@@ -0,0 +1,367 @@
+/**
+ * @file resize.c
+ * @date 16 Oct 2026
+ * @brief Resampling of images with bilinear, bicubic and Lanczos filters.
+ *
+ * The filters are separable: a horizontal pass resamples the rows of the source image
+ * into an intermediate image of the destination width, then a vertical pass resamples its
+ * columns into the destination image. When downscaling, the filters are stretched by the
+ * scale factor so that every source pixel contributes to the result.
+ *
+ * The weights of each axis are computed once: for every output coordinate, the index of
+ * its first source tap and the weights of its taps, normalized and converted to 16-bit
+ * fixed point with 14 fractional bits. Taps falling outside of the image are dropped and
+ * the remaining weights renormalized. The weights are stored by pairs, so that SSE2
+ * pmaddwd multiplies two interleaved taps by their weights and adds them in a single
+ * instruction:
+ * - the horizontal pass computes the 3 components of an output pixel in one vector, from
+ *   two neighbouring source pixels at a time;
+ * - the vertical pass treats the rows as flat arrays of components, 8 at a time.
+ * Both passes round and saturate their results to 8 bits.
+ *
+ * When the source size is an integer multiple of the destination size along the rows,
+ * the taps of all output pixels away from the edges have the same weights and are evenly
+ * spaced: these pixels take a fast path, stepping through the row with a single set of
+ * weights kept in registers instead of looking up the first tap and the weights of each
+ * pixel. The fast path is instantiated with constant numbers of taps, so that the loop
+ * over the taps is unrolled, for factors up to 6 (bilinear), 3 (bicubic) and 2 (Lanczos).
+ *
+ * Both passes are spread over the default thread pool by bands of rows (see parallel.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "resize.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Fractional bits of the fixed point weights
+#define WEIGHT_SHIFT 14
+
+// Largest number of pairs of taps of the specialized fast paths of integer downscales
+#define MAX_REGULAR_PAIRS 6
+
+// Weights of the taps along one axis
+typedef struct {
+    int npairs;         // number of pairs of taps of each output
+    int *first;         // index of the first source tap of each output
+    int32_t *pairs;     // npairs pairs of weights per output, the second one in the high half
+    int step;           // integer downscale factor, 0 if the scale is not an integer
+    int start, end;     // outputs [start, end[ have the weights of output start, step apart
+} axis_t;
+
+// Arguments of the passes
+typedef struct {
+    img_t *src, *dst;
+    img_t *tmp;         // result of the horizontal pass
+    axis_t h, v;
+    atomic_bool failed; // whether an allocation failed
+} resize_t;
+
+static double filter_radius(enum RESIZE_FILTER filter);
+static double filter_weight(enum RESIZE_FILTER filter, double x);
+static bool make_axis(axis_t *axis, int src_size, int dst_size, enum RESIZE_FILTER filter);
+static void free_axis(axis_t *axis);
+typedef void (*regular_t)(const uint8_t *p, const int32_t *pairs, int npairs, int step, uint8_t *out, int count);
+static void horizontal_band(void *arg, int first, int last);
+static void vertical_band(void *arg, int first, int last);
+
+/**
+ * Resample an image to the size of another one.
+ * @param src a pointer to the image to resample
+ * @param dst a pointer to the image receiving the result, of any size (not src, unless
+ *        the sizes are the same)
+ * @param filter the resampling filter
+ * @return false if an allocation failed, true otherwise
+ */
+bool resize(img_t *src, img_t *dst, enum RESIZE_FILTER filter) {
+    if (src->width == dst->width && src->height == dst->height) {
+        if (dst != src) memcpy(dst->pix1d, src->pix1d, sizeof(pixel_t) * src->width * src->height);
+        return true;
+    }
+    if (dst->width == 0 || dst->height == 0) return true;
+    if (src->width == 0 || src->height == 0) return false;
+
+    resize_t rs = { src, dst, NULL, { 0 }, { 0 }, false };
+    if (!make_axis(&rs.h, src->width, dst->width, filter) ||
+        !make_axis(&rs.v, src->height, dst->height, filter)) {
+        atomic_store(&rs.failed, true);
+        goto out;
+    }
+
+    // An axis of unchanged size needs no pass: the filters are 1 at 0 and 0 at other integers
+    if (src->width == dst->width) rs.tmp = src;
+    else if (src->height == dst->height) rs.tmp = dst;
+    else if (!(rs.tmp = alloc_img(dst->width, src->height))) {
+        atomic_store(&rs.failed, true);
+        goto out;
+    }
+
+    if (src->width != dst->width)
+        parallel_for(default_pool(), 0, src->height, band_grain(sizeof(pixel_t) * src->width),
+                     horizontal_band, &rs);
+    if (src->height != dst->height && !atomic_load(&rs.failed))
+        parallel_for(default_pool(), 0, dst->height, band_grain(sizeof(pixel_t) * dst->width * 2*rs.v.npairs),
+                     vertical_band, &rs);
+
+out:
+    if (rs.tmp && rs.tmp != src && rs.tmp != dst) free_img(rs.tmp);
+    free_axis(&rs.h);
+    free_axis(&rs.v);
+    return !atomic_load(&rs.failed);
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Radius of a filter at scale 1, in pixels.
+static double filter_radius(enum RESIZE_FILTER filter) {
+    switch (filter) {
+    case RESIZE_BICUBIC: return 2;
+    case RESIZE_LANCZOS: return 3;
+    default: return 1;
+    }
+}
+
+// Value of a filter at distance x from its center.
+static double filter_weight(enum RESIZE_FILTER filter, double x) {
+    const double a = -0.5;
+    x = fabs(x);
+    switch (filter) {
+    case RESIZE_BICUBIC:
+        if (x < 1) return ((a + 2) * x - (a + 3)) * x * x + 1;
+        if (x < 2) return ((x - 5) * x + 8) * x * a - 4 * a;
+        return 0;
+    case RESIZE_LANCZOS:
+        if (x == 0) return 1;
+        if (x < 3) return 3 * sin(M_PI * x) * sin(M_PI * x / 3) / (M_PI * M_PI * x * x);
+        return 0;
+    default:
+        return x < 1 ? 1 - x : 0;
+    }
+}
+
+// Compute the taps of the outputs of an axis resampled from src_size to dst_size pixels.
+static bool make_axis(axis_t *axis, int src_size, int dst_size, enum RESIZE_FILTER filter) {
+    double scale = (double)src_size / dst_size;
+    double stretch = scale > 1 ? scale : 1;
+    double support = filter_radius(filter) * stretch;
+    int ntaps = (int)ceil(2 * support);
+    axis->npairs = (ntaps + 1) / 2;
+    axis->first = malloc(sizeof(int) * dst_size);
+    axis->pairs = calloc((size_t)dst_size * axis->npairs, sizeof(int32_t));
+    double *w = malloc(sizeof(double) * ntaps);
+    if (!axis->first || !axis->pairs || !w) {
+        free(w);
+        return false;
+    }
+
+    axis->step = src_size % dst_size == 0 ? src_size / dst_size : 0;
+    axis->start = dst_size;
+    axis->end = 0;
+    for (int i = 0; i < dst_size; i++) {
+        // Pixel j covers [j, j+1[: the taps are the pixels whose center is strictly within
+        // the support, [lo, hi[
+        double center = (i + 0.5) * scale;
+        int lo = (int)floor(center - support - 0.5) + 1, hi = (int)ceil(center + support - 0.5);
+        if (lo >= 0 && hi <= src_size) {
+            if (i < axis->start) axis->start = i;
+            axis->end = i + 1;
+        }
+        if (lo < 0) lo = 0;
+        if (hi > src_size) hi = src_size;
+        if (hi - lo > ntaps) hi = lo + ntaps;
+
+        double sum = 0;
+        for (int k = 0; k < hi - lo; k++) {
+            w[k] = filter_weight(filter, (lo + k + 0.5 - center) / stretch);
+            sum += w[k];
+        }
+        // Round the weights and give the rounding error to the largest one, so that they
+        // sum up to 1
+        int16_t fixed[2 * axis->npairs];
+        int total = 0, largest = 0;
+        memset(fixed, 0, sizeof(fixed));
+        for (int k = 0; k < hi - lo; k++) {
+            fixed[k] = lround(w[k] / sum * (1 << WEIGHT_SHIFT));
+            total += fixed[k];
+            if (w[k] > w[largest]) largest = k;
+        }
+        fixed[largest] += (1 << WEIGHT_SHIFT) - total;
+
+        axis->first[i] = lo;
+        for (int p = 0; p < axis->npairs; p++)
+            axis->pairs[(size_t)i * axis->npairs + p] = (int32_t)((uint16_t)fixed[2*p] | (uint32_t)(uint16_t)fixed[2*p + 1] << 16);
+    }
+    if (!axis->step || axis->start >= axis->end) axis->start = axis->end = 0;
+    free(w);
+    return true;
+}
+
+// Free the taps of an axis.
+static void free_axis(axis_t *axis) {
+    free(axis->first);
+    free(axis->pairs);
+}
+
+#ifdef __SSE2__
+// Weighted sum of the pixels at p and p+1 (3 bytes each), in lanes 0 to 2. Reads 8 bytes.
+static inline __m128i pixel_pair(const uint8_t *p, __m128i w) {
+    __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128());
+    __m128i b = _mm_srli_si128(a, 6);
+    // r0 r1 g0 g1 b0 b1 (r1 r2)
+    return _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w);
+}
+
+// Round a sum of weighted components and store it as the 3 components of a pixel.
+static inline void store_pixel(uint8_t *out, __m128i acc) {
+    __m128i v = _mm_srai_epi32(_mm_add_epi32(acc, _mm_set1_epi32(1 << (WEIGHT_SHIFT - 1))), WEIGHT_SHIFT);
+    v = _mm_packs_epi32(v, v);
+    int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+    memcpy(out, &bytes, 3);
+}
+#endif
+
+// Resample an output pixel from the pixels of a row starting at p, with npairs pairs of
+// weights.
+static inline void resample_pixel(const uint8_t *p, const int32_t *pairs, int npairs, uint8_t *out) {
+#ifdef __SSE2__
+    __m128i acc = _mm_setzero_si128();
+    for (int k = 0; k < npairs; k++)
+        acc = _mm_add_epi32(acc, pixel_pair(p + 6*k, _mm_set1_epi32(pairs[k])));
+    store_pixel(out, acc);
+#else
+    for (int c = 0; c < 3; c++) {
+        int32_t acc = 1 << (WEIGHT_SHIFT - 1);
+        for (int k = 0; k < npairs; k++)
+            acc += (int16_t)pairs[k] * p[6*k + c] + (int16_t)(pairs[k] >> 16) * p[6*k + 3 + c];
+        acc >>= WEIGHT_SHIFT;
+        out[c] = acc < 0 ? 0 : acc > 255 ? 255 : acc;
+    }
+#endif
+}
+
+// Resample count outputs of a row with the same weights, the taps of each output step
+// pixels after those of the previous one; inlined with constant values of npairs, so that
+// the loop over the taps is unrolled and the weights stay in registers.
+static inline __attribute__((always_inline)) void resample_regular(const uint8_t *p, const int32_t *pairs, int npairs,
+                                                                   int step, uint8_t *out, int count) {
+#ifdef __SSE2__
+    __m128i w[npairs];
+    for (int k = 0; k < npairs; k++)
+        w[k] = _mm_set1_epi32(pairs[k]);
+    for (int i = 0; i < count; i++, p += 3*step) {
+        __m128i acc = _mm_setzero_si128();
+        for (int k = 0; k < npairs; k++)
+            acc = _mm_add_epi32(acc, pixel_pair(p + 6*k, w[k]));
+        store_pixel(out + 3*i, acc);
+    }
+#else
+    for (int i = 0; i < count; i++, p += 3*step)
+        resample_pixel(p, pairs, npairs, out + 3*i);
+#endif
+}
+
+#define DEFINE_REGULAR(N) \
+    static void resample_regular_##N(const uint8_t *p, const int32_t *pairs, int npairs, int step, \
+                                     uint8_t *out, int count) { \
+        (void)npairs; \
+        resample_regular(p, pairs, N, step, out, count); \
+    }
+
+DEFINE_REGULAR(1)
+DEFINE_REGULAR(2)
+DEFINE_REGULAR(3)
+DEFINE_REGULAR(4)
+DEFINE_REGULAR(5)
+DEFINE_REGULAR(6)
+
+// Any other number of pairs, known at runtime only
+static void resample_regular_n(const uint8_t *p, const int32_t *pairs, int npairs, int step, uint8_t *out, int count) {
+    resample_regular(p, pairs, npairs, step, out, count);
+}
+
+static const regular_t regular_kernels[MAX_REGULAR_PAIRS + 1] = {
+    NULL, resample_regular_1, resample_regular_2, resample_regular_3,
+    resample_regular_4, resample_regular_5, resample_regular_6
+};
+
+// Horizontal pass of source rows [first, last[, into the intermediate image.
+static void horizontal_band(void *arg, int first, int last) {
+    resize_t *rs = arg;
+    axis_t *h = &rs->h;
+    int width = rs->src->width;
+    // The taps of the last outputs and the 8-byte loads of the last pairs go past the end
+    // of the row: copy it into a buffer padded with zeros
+    uint8_t *row = calloc(sizeof(pixel_t) * (width + 2*h->npairs + 3), 1);
+    if (!row) {
+        atomic_store(&rs->failed, true);
+        return;
+    }
+    regular_t regular = h->npairs <= MAX_REGULAR_PAIRS ? regular_kernels[h->npairs] : resample_regular_n;
+
+    for (int j = first; j < last; j++) {
+        memcpy(row, rs->src->pix2d[j], sizeof(pixel_t) * width);
+        uint8_t *out = (uint8_t *)rs->tmp->pix2d[j];
+        for (int i = 0; i < h->start; i++)
+            resample_pixel(row + 3 * h->first[i], h->pairs + (size_t)i * h->npairs, h->npairs, out + 3*i);
+        regular(row + 3 * h->first[h->start], h->pairs + (size_t)h->start * h->npairs, h->npairs, h->step,
+                out + 3 * h->start, h->end - h->start);
+        for (int i = h->end; i < rs->dst->width; i++)
+            resample_pixel(row + 3 * h->first[i], h->pairs + (size_t)i * h->npairs, h->npairs, out + 3*i);
+    }
+    free(row);
+}
+
+// Vertical pass of destination rows [first, last[, from the intermediate image.
+static void vertical_band(void *arg, int first, int last) {
+    resize_t *rs = arg;
+    axis_t *v = &rs->v;
+    int height = rs->tmp->height;
+    size_t count = (size_t)3 * rs->dst->width;
+    const uint8_t **taps = malloc(sizeof(uint8_t *) * 2 * v->npairs);
+    if (!taps) {
+        atomic_store(&rs->failed, true);
+        return;
+    }
+
+    for (int j = first; j < last; j++) {
+        const int32_t *pairs = v->pairs + (size_t)j * v->npairs;
+        // Taps past the last row have a weight of 0 but must be readable
+        for (int k = 0; k < 2 * v->npairs; k++) {
+            int y = v->first[j] + k;
+            taps[k] = (const uint8_t *)rs->tmp->pix2d[y < height ? y : height - 1];
+        }
+        uint8_t *out = (uint8_t *)rs->dst->pix2d[j];
+        size_t i = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi32(1 << (WEIGHT_SHIFT - 1));
+        for (; i + 8 <= count; i += 8) {
+            __m128i acc_lo = round, acc_hi = round;
+            for (int k = 0; k < v->npairs; k++) {
+                __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(taps[2*k] + i)), zero);
+                __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(taps[2*k + 1] + i)), zero);
+                __m128i w = _mm_set1_epi32(pairs[k]);
+                acc_lo = _mm_add_epi32(acc_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                acc_hi = _mm_add_epi32(acc_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+            }
+            __m128i s = _mm_packs_epi32(_mm_srai_epi32(acc_lo, WEIGHT_SHIFT), _mm_srai_epi32(acc_hi, WEIGHT_SHIFT));
+            _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(s, s));
+        }
+#endif
+        for (; i < count; i++) {
+            int32_t acc = 1 << (WEIGHT_SHIFT - 1);
+            for (int k = 0; k < v->npairs; k++)
+                acc += (int16_t)pairs[k] * taps[2*k][i] + (int16_t)(pairs[k] >> 16) * taps[2*k + 1][i];
+            acc >>= WEIGHT_SHIFT;
+            out[i] = acc < 0 ? 0 : acc > 255 ? 255 : acc;
+        }
+    }
+    free(taps);
+}
@@ -0,0 +1,22 @@
+/**
+ * @file resize.h
+ * @date 16 Oct 2026
+ * @brief Resampling of images with bilinear, bicubic and Lanczos filters.
+ */
+
+#ifndef RESIZE_H
+#define RESIZE_H
+
+#include <stdbool.h>
+#include "ppm.h"
+
+// Resampling filters, from the fastest to the sharpest
+enum RESIZE_FILTER {
+    RESIZE_BILINEAR,    // triangle of radius 1
+    RESIZE_BICUBIC,     // Keys cubic (a = -0.5) of radius 2
+    RESIZE_LANCZOS      // Lanczos of radius 3
+};
+
+extern bool resize(img_t *src, img_t *dst, enum RESIZE_FILTER filter);
+
+#endif
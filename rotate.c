@@ -0,0 +1,324 @@
+/**
+ * @file rotate.c
+ * @date 16 Oct 2026
+ * @brief Transposition, rotations by multiples of 90 degrees and flips of images.
+ *
+ * Transposing or rotating an image by 90 degrees reads its rows and writes them as columns
+ * (or the reverse): a naive loop touches a new cache line for every pixel on one side.
+ * The image is instead recursively split along its larger dimension into blocks of at
+ * most LEAF_SIZE pixels per side, whose rows in the source and in the destination all
+ * fit in the L1 cache, whatever its size (cache-oblivious traversal). The blocks are then
+ * processed 4x4 pixels at a time: with SSSE3 when the CPU supports it, the 4 rows of 4
+ * pixels are expanded to 4 bytes per pixel, transposed as a 4x4 matrix of 32-bit
+ * elements with unpack instructions, and packed back to 3 bytes per pixel (reversing the
+ * order of the pixels for the rotations that need it).
+ *
+ * The rotation by 180 degrees and the flips keep rows as rows: the rows are copied or
+ * reversed, 4 pixels at a time with SSSE3. They can be done in place, swapping the rows
+ * through a buffer.
+ *
+ * Everything runs on the default thread pool (see parallel.h): strips of STRIP_ROWS source
+ * rows for the transpositions, bands of rows for the others.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "rotate.h"
+#include "parallel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86
+#endif
+
+// Largest width and height of the blocks of the recursive traversal, a multiple of 4
+#define LEAF_SIZE 16
+
+// Number of source rows of the strips run in parallel by the transpositions
+#define STRIP_ROWS 64
+
+// How source pixel (x, y) maps to the destination
+enum ROTATION {
+    TRANSPOSE,  // to (y, x)
+    ROTATE_90,  // to (height-1-y, x), clockwise
+    ROTATE_270  // to (y, width-1-x), counterclockwise
+};
+
+// Transpose a block of 4x4 pixels from src (rows stride pixels apart) into 4 rows of dst
+// (step pixels apart), optionally reversing the order of the pixels of the rows
+typedef void (*block4_t)(const pixel_t *src, int stride, pixel_t *dst, ptrdiff_t step, bool reverse);
+
+// Copy or reverse a row of width pixels
+typedef void (*row_op_t)(const pixel_t *src, pixel_t *dst, int width);
+
+// Arguments of the transpositions
+typedef struct {
+    img_t *src, *dst;
+    enum ROTATION rotation;
+    block4_t block4;
+} rotate_t;
+
+// Arguments of the rotation by 180 degrees and the flips
+typedef struct {
+    img_t *src, *dst;
+    bool pairs;         // whether rows j and height-1-j are exchanged
+    row_op_t op;
+    atomic_bool failed; // whether an allocation failed
+} flip_t;
+
+static bool rotate(img_t *src, img_t *dst, enum ROTATION rotation);
+static void rotate_strips(void *arg, int first, int last);
+static void rotate_block(const rotate_t *rot, int x, int y, int width, int height);
+static bool flip(img_t *src, img_t *dst, bool pairs, bool reverse);
+static void flip_band(void *arg, int first, int last);
+static void block4(const pixel_t *src, int stride, pixel_t *dst, ptrdiff_t step, bool reverse);
+static void copy_row(const pixel_t *src, pixel_t *dst, int width);
+static void reverse_row(const pixel_t *src, pixel_t *dst, int width);
+#ifdef HAVE_X86
+static void block4_ssse3(const pixel_t *src, int stride, pixel_t *dst, ptrdiff_t step, bool reverse);
+static void reverse_row_ssse3(const pixel_t *src, pixel_t *dst, int width);
+#endif
+
+/**
+ * Transpose an image: pixel (x, y) moves to (y, x).
+ * @param src a pointer to the image to transpose
+ * @param dst a pointer to the image receiving the result, of the size of src swapped (not src)
+ * @return false if the size of dst is wrong or dst is src, true otherwise
+ */
+bool transpose(img_t *src, img_t *dst) {
+    return rotate(src, dst, TRANSPOSE);
+}
+
+/**
+ * Rotate an image by 90 degrees clockwise.
+ * @param src a pointer to the image to rotate
+ * @param dst a pointer to the image receiving the result, of the size of src swapped (not src)
+ * @return false if the size of dst is wrong or dst is src, true otherwise
+ */
+bool rotate90(img_t *src, img_t *dst) {
+    return rotate(src, dst, ROTATE_90);
+}
+
+/**
+ * Rotate an image by 180 degrees.
+ * @param src a pointer to the image to rotate
+ * @param dst a pointer to the image receiving the result, of the same size; it may be src
+ * @return false if the sizes of the images differ or an allocation failed, true otherwise
+ */
+bool rotate180(img_t *src, img_t *dst) {
+    return flip(src, dst, true, true);
+}
+
+/**
+ * Rotate an image by 90 degrees counterclockwise (270 degrees clockwise).
+ * @param src a pointer to the image to rotate
+ * @param dst a pointer to the image receiving the result, of the size of src swapped (not src)
+ * @return false if the size of dst is wrong or dst is src, true otherwise
+ */
+bool rotate270(img_t *src, img_t *dst) {
+    return rotate(src, dst, ROTATE_270);
+}
+
+/**
+ * Flip an image horizontally (mirror left to right).
+ * @param src a pointer to the image to flip
+ * @param dst a pointer to the image receiving the result, of the same size; it may be src
+ * @return false if the sizes of the images differ or an allocation failed, true otherwise
+ */
+bool flip_horizontal(img_t *src, img_t *dst) {
+    return flip(src, dst, false, true);
+}
+
+/**
+ * Flip an image vertically (upside down).
+ * @param src a pointer to the image to flip
+ * @param dst a pointer to the image receiving the result, of the same size; it may be src
+ * @return false if the sizes of the images differ or an allocation failed, true otherwise
+ */
+bool flip_vertical(img_t *src, img_t *dst) {
+    return flip(src, dst, true, false);
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Transpose or rotate by 90 degrees an image into another one.
+static bool rotate(img_t *src, img_t *dst, enum ROTATION rotation) {
+    if (src->width != dst->height || src->height != dst->width || src == dst) return false;
+
+    rotate_t rot = { src, dst, rotation, block4 };
+#ifdef HAVE_X86
+    if (__builtin_cpu_supports("ssse3")) rot.block4 = block4_ssse3;
+#endif
+    int nstrips = (src->height + STRIP_ROWS - 1) / STRIP_ROWS;
+    parallel_for(default_pool(), 0, nstrips, 1, rotate_strips, &rot);
+    return true;
+}
+
+// Transpose strips [first, last[ of STRIP_ROWS source rows.
+static void rotate_strips(void *arg, int first, int last) {
+    rotate_t *rot = arg;
+    for (int s = first; s < last; s++) {
+        int y = s * STRIP_ROWS;
+        int height = rot->src->height - y < STRIP_ROWS ? rot->src->height - y : STRIP_ROWS;
+        rotate_block(rot, 0, y, rot->src->width, height);
+    }
+}
+
+// Destination of source pixel (x, y).
+static inline pixel_t *target(const rotate_t *rot, int x, int y) {
+    switch (rot->rotation) {
+    case ROTATE_90: return rot->dst->pix2d[x] + (rot->src->height - 1 - y);
+    case ROTATE_270: return rot->dst->pix2d[rot->src->width - 1 - x] + y;
+    default: return rot->dst->pix2d[x] + y;
+    }
+}
+
+// Transpose the block of source pixels at (x, y), splitting it in two along its larger
+// dimension (at a multiple of 4) until it fits in LEAF_SIZE*LEAF_SIZE pixels.
+static void rotate_block(const rotate_t *rot, int x, int y, int width, int height) {
+    if (width > LEAF_SIZE || height > LEAF_SIZE) {
+        if (width >= height) {
+            int half = (width / 2 + 3) / 4 * 4;
+            rotate_block(rot, x, y, half, height);
+            rotate_block(rot, x + half, y, width - half, height);
+        }
+        else {
+            int half = (height / 2 + 3) / 4 * 4;
+            rotate_block(rot, x, y, width, half);
+            rotate_block(rot, x, y + half, width, height - half);
+        }
+        return;
+    }
+
+    // The rows of the destination of a 4x4 block start at the pixel of its first row
+    // (its last row when rotating clockwise) and follow each other (precede when rotating
+    // counterclockwise)
+    ptrdiff_t step = rot->rotation == ROTATE_270 ? -rot->dst->width : rot->dst->width;
+    bool reverse = rot->rotation == ROTATE_90;
+    for (int j = y; j < y + height; j += 4) {
+        for (int i = x; i < x + width; i += 4) {
+            if (j + 4 <= y + height && i + 4 <= x + width) {
+                rot->block4(rot->src->pix2d[j] + i, rot->src->width, target(rot, i, reverse ? j + 3 : j), step, reverse);
+                continue;
+            }
+            for (int jj = j; jj < j + 4 && jj < y + height; jj++)
+                for (int ii = i; ii < i + 4 && ii < x + width; ii++)
+                    *target(rot, ii, jj) = rot->src->pix2d[jj][ii];
+        }
+    }
+}
+
+// Rotate by 180 degrees or flip an image, possibly in place.
+static bool flip(img_t *src, img_t *dst, bool pairs, bool reverse) {
+    if (src->width != dst->width || src->height != dst->height) return false;
+
+    flip_t fl = { src, dst, pairs, reverse ? reverse_row : copy_row, false };
+#ifdef HAVE_X86
+    if (reverse && __builtin_cpu_supports("ssse3")) fl.op = reverse_row_ssse3;
+#endif
+    int nrows = pairs ? (src->height + 1) / 2 : src->height;
+    parallel_for(default_pool(), 0, nrows, band_grain(2 * sizeof(pixel_t) * src->width), flip_band, &fl);
+    return !atomic_load(&fl.failed);
+}
+
+// Process rows [first, last[: row j of the destination gets row k of the source, where k
+// is height-1-j when exchanging pairs of rows (and the reverse), j otherwise.
+static void flip_band(void *arg, int first, int last) {
+    flip_t *fl = arg;
+    int width = fl->src->width;
+    // In place, the source row is saved before being overwritten
+    pixel_t *tmp = NULL;
+    if (fl->src == fl->dst) {
+        tmp = malloc(sizeof(pixel_t) * (width > 0 ? width : 1));
+        if (!tmp) {
+            atomic_store(&fl->failed, true);
+            return;
+        }
+    }
+
+    for (int j = first; j < last; j++) {
+        int k = fl->pairs ? fl->src->height - 1 - j : j;
+        const pixel_t *a = fl->src->pix2d[j];
+        if (tmp) {
+            memcpy(tmp, a, sizeof(pixel_t) * width);
+            a = tmp;
+        }
+        if (k == j) {
+            fl->op(a, fl->dst->pix2d[j], width);
+        }
+        else {
+            fl->op(fl->src->pix2d[k], fl->dst->pix2d[j], width);
+            fl->op(a, fl->dst->pix2d[k], width);
+        }
+    }
+    free(tmp);
+}
+
+// Transpose a block of 4x4 pixels (scalar version).
+static void block4(const pixel_t *src, int stride, pixel_t *dst, ptrdiff_t step, bool reverse) {
+    for (int k = 0; k < 4; k++)
+        for (int r = 0; r < 4; r++)
+            dst[k * step + (reverse ? 3 - r : r)] = src[r * stride + k];
+}
+
+// Copy a row.
+static void copy_row(const pixel_t *src, pixel_t *dst, int width) {
+    memcpy(dst, src, sizeof(pixel_t) * width);
+}
+
+// Reverse the order of the pixels of a row (scalar version).
+static void reverse_row(const pixel_t *src, pixel_t *dst, int width) {
+    for (int i = 0; i < width; i++)
+        dst[i] = src[width - 1 - i];
+}
+
+#ifdef HAVE_X86
+// Load 4 pixels (12 bytes, without reading past them).
+static inline __m128i load12(const pixel_t *p) {
+    int32_t last;
+    memcpy(&last, (const uint8_t *)p + 8, 4);
+    return _mm_or_si128(_mm_loadl_epi64((const __m128i *)p), _mm_slli_si128(_mm_cvtsi32_si128(last), 8));
+}
+
+// Store 4 pixels (the first 12 bytes of v).
+static inline void store12(pixel_t *p, __m128i v) {
+    _mm_storel_epi64((__m128i *)p, v);
+    int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy((uint8_t *)p + 8, &last, 4);
+}
+
+// Transpose a block of 4x4 pixels as a 4x4 matrix of 32-bit elements.
+__attribute__((target("ssse3")))
+static void block4_ssse3(const pixel_t *src, int stride, pixel_t *dst, ptrdiff_t step, bool reverse) {
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i pack = reverse ?
+        _mm_setr_epi8(12, 13, 14, 8, 9, 10, 4, 5, 6, 0, 1, 2, -1, -1, -1, -1) :
+        _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m128i r0 = _mm_shuffle_epi8(load12(src), expand);
+    __m128i r1 = _mm_shuffle_epi8(load12(src + stride), expand);
+    __m128i r2 = _mm_shuffle_epi8(load12(src + 2*stride), expand);
+    __m128i r3 = _mm_shuffle_epi8(load12(src + 3*stride), expand);
+    // a0 b0 a1 b1, c0 d0 c1 d1, a2 b2 a3 b3, c2 d2 c3 d3
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+    store12(dst, _mm_shuffle_epi8(_mm_unpacklo_epi64(t0, t1), pack));
+    store12(dst + step, _mm_shuffle_epi8(_mm_unpackhi_epi64(t0, t1), pack));
+    store12(dst + 2*step, _mm_shuffle_epi8(_mm_unpacklo_epi64(t2, t3), pack));
+    store12(dst + 3*step, _mm_shuffle_epi8(_mm_unpackhi_epi64(t2, t3), pack));
+}
+
+// Reverse the order of the pixels of a row, 4 pixels at a time.
+__attribute__((target("ssse3")))
+static void reverse_row_ssse3(const pixel_t *src, pixel_t *dst, int width) {
+    const __m128i reverse = _mm_setr_epi8(9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2, -1, -1, -1, -1);
+    int i = 0;
+    for (; i + 4 <= width; i += 4)
+        store12(dst + i, _mm_shuffle_epi8(load12(src + width - 4 - i), reverse));
+    for (; i < width; i++)
+        dst[i] = src[width - 1 - i];
+}
+#endif
@@ -0,0 +1,20 @@
+/**
+ * @file rotate.h
+ * @date 16 Oct 2026
+ * @brief Transposition, rotations by multiples of 90 degrees and flips of images.
+ */
+
+#ifndef ROTATE_H
+#define ROTATE_H
+
+#include <stdbool.h>
+#include "ppm.h"
+
+extern bool transpose(img_t *src, img_t *dst);
+extern bool rotate90(img_t *src, img_t *dst);
+extern bool rotate180(img_t *src, img_t *dst);
+extern bool rotate270(img_t *src, img_t *dst);
+extern bool flip_horizontal(img_t *src, img_t *dst);
+extern bool flip_vertical(img_t *src, img_t *dst);
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * @file tile.c
+ * @date 16 Oct 2026
+ * @brief Parallel execution of kernels over 2D tiles, with halo and border handling.
+ *
+ * Kernels reading a neighborhood of each pixel (blurs, convolutions...) run over bands of
+ * full rows miss the cache on wide images: the rows above and below are evicted before
+ * being used again. Here the image is cut into tiles small enough for their working set
+ * to stay in L2, whatever the width of the image. Before running the kernel on a tile,
+ * its source pixels and a halo around it are copied into a contiguous window, the pixels
+ * outside of the image being made up according to a border mode, so that kernels never
+ * test for edges.
+ *
+ * The tiles are numbered row by row and distributed with parallel_for (see parallel.h)
+ * in runs of tiles: each thread gets a contiguous slice of runs and steals runs from the
+ * other threads once done with its own. The window buffer, and the scratch memory the
+ * kernel may ask for, are allocated once per run and reused by all of its tiles; about
+ * RUNS_PER_THREAD runs per thread keep the allocations rare while leaving enough runs to
+ * balance the load.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "tile.h"
+#include "parallel.h"
+
+// Number of runs of tiles per thread of the pool
+#define RUNS_PER_THREAD 4
+
+typedef struct {
+    img_t *src;
+    int width, height;
+    int tile_width, tile_height;
+    int tiles_per_row;
+    int halo;
+    enum BORDER_MODE border;
+    size_t scratch_bytes;
+    tile_kernel_t kernel;
+    void *arg;
+    atomic_bool failed;     // whether a window could not be allocated
+} tiling_t;
+
+static void tile_band(void *arg, int first, int last);
+static void fill_window(tiling_t *tiling, tile_t *tile, pixel_t *buf);
+
+/**
+ * Map a coordinate possibly outside of [0, n[ to the coordinate of the pixel replacing it.
+ * @param i the coordinate
+ * @param n the size of the image along the coordinate's axis (at least 1)
+ * @param border how pixels outside of the image are made up
+ * @return the coordinate within [0, n[, or -1 for a black pixel (BORDER_ZERO)
+ */
+int border_index(int i, int n, enum BORDER_MODE border) {
+    if (i >= 0 && i < n) return i;
+    switch (border) {
+        case BORDER_CLAMP:
+            return i < 0 ? 0 : n - 1;
+        case BORDER_MIRROR: {
+            if (n == 1) return 0;
+            // Reflection is periodic, of period 2*(n-1)
+            int period = 2 * (n - 1);
+            i %= period;
+            if (i < 0) i += period;
+            return i < n ? i : period - i;
+        }
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Run a kernel over the tiles of a width*height area, on the default thread pool.
+ * The kernel typically writes the result for the pixels of the tile to a destination image.
+ * @param src the source image whose pixels are copied into the tiles' windows, of size
+ *        width*height, or NULL if the kernel needs no window
+ * @param width the width of the area to process
+ * @param height the height of the area to process
+ * @param tile_width the width of a tile, or 0 for DEFAULT_TILE_SIZE
+ * @param tile_height the height of a tile, or 0 for DEFAULT_TILE_SIZE
+ * @param halo the number of pixels needed around the tiles (0 or more)
+ * @param border how the pixels of the halo outside of the image are made up
+ * @param kernel the kernel to run on each tile
+ * @param arg the argument passed to the kernel
+ * @return false if the source image doesn't match the area or an allocation failed
+ */
+bool for_each_tile(img_t *src, int width, int height, int tile_width, int tile_height, int halo,
+                   enum BORDER_MODE border, tile_kernel_t kernel, void *arg) {
+    return for_each_tile_scratch(src, width, height, tile_width, tile_height, halo, border, 0, kernel, arg);
+}
+
+/**
+ * Run a kernel over the tiles of a width*height area, on the default thread pool, handing
+ * it scratch memory reused from tile to tile (see for_each_tile).
+ * @param src the source image whose pixels are copied into the tiles' windows, of size
+ *        width*height, or NULL if the kernel needs no window
+ * @param width the width of the area to process
+ * @param height the height of the area to process
+ * @param tile_width the width of a tile, or 0 for DEFAULT_TILE_SIZE
+ * @param tile_height the height of a tile, or 0 for DEFAULT_TILE_SIZE
+ * @param halo the number of pixels needed around the tiles (0 or more)
+ * @param border how the pixels of the halo outside of the image are made up
+ * @param scratch_bytes the size of the scratch memory of the tiles (0 for none)
+ * @param kernel the kernel to run on each tile
+ * @param arg the argument passed to the kernel
+ * @return false if the source image doesn't match the area or an allocation failed
+ */
+bool for_each_tile_scratch(img_t *src, int width, int height, int tile_width, int tile_height, int halo,
+                           enum BORDER_MODE border, size_t scratch_bytes, tile_kernel_t kernel, void *arg) {
+    if (src && (src->width != width || src->height != height)) return false;
+    if (width <= 0 || height <= 0) return true;
+    if (tile_width <= 0) tile_width = DEFAULT_TILE_SIZE;
+    if (tile_height <= 0) tile_height = DEFAULT_TILE_SIZE;
+    if (halo < 0) halo = 0;
+
+    tiling_t tiling = { src, width, height, tile_width, tile_height,
+                        (width + tile_width - 1) / tile_width, halo, border, scratch_bytes, kernel, arg, false };
+    int ntiles = tiling.tiles_per_row * ((height + tile_height - 1) / tile_height);
+    int nruns = RUNS_PER_THREAD * pool_size(default_pool());
+    parallel_for(default_pool(), 0, ntiles, (ntiles + nruns - 1) / nruns, tile_band, &tiling);
+    return !atomic_load(&tiling.failed);
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Process a run of tiles [first, last[, reusing the same window buffer and scratch memory.
+static void tile_band(void *arg, int first, int last) {
+    tiling_t *tiling = arg;
+    pixel_t *buf = NULL;
+    void *scratch = NULL;
+    if (tiling->src)
+        buf = malloc(sizeof(pixel_t) * (tiling->tile_width + 2*tiling->halo) *
+                     (tiling->tile_height + 2*tiling->halo));
+    if (tiling->scratch_bytes > 0)
+        scratch = malloc(tiling->scratch_bytes);
+    if ((tiling->src && !buf) || (tiling->scratch_bytes > 0 && !scratch)) {
+        atomic_store(&tiling->failed, true);
+        goto out;
+    }
+
+    for (int t = first; t < last; t++) {
+        tile_t tile;
+        tile.x = t % tiling->tiles_per_row * tiling->tile_width;
+        tile.y = t / tiling->tiles_per_row * tiling->tile_height;
+        tile.width = tiling->width - tile.x < tiling->tile_width ? tiling->width - tile.x : tiling->tile_width;
+        tile.height = tiling->height - tile.y < tiling->tile_height ? tiling->height - tile.y : tiling->tile_height;
+        tile.halo = tiling->halo;
+        tile.stride = tile.width + 2*tile.halo;
+        tile.window = NULL;
+        tile.scratch = scratch;
+        if (buf) fill_window(tiling, &tile, buf);
+        tiling->kernel(tiling->arg, &tile);
+    }
+
+out:
+    free(scratch);
+    free(buf);
+}
+
+// Copy the source pixels of a tile and its halo into buf.
+static void fill_window(tiling_t *tiling, tile_t *tile, pixel_t *buf) {
+    img_t *src = tiling->src;
+    int halo = tile->halo;
+    int x0 = tile->x - halo;
+    int x1 = tile->x + tile->width + halo;
+    // Columns [inside_first, inside_last[ of the window are within the image (at least the
+    // tile's columns)
+    int inside_first = x0 < 0 ? -x0 : 0;
+    int inside_last = x1 > src->width ? tile->stride - (x1 - src->width) : tile->stride;
+    const pixel_t black = { 0, 0, 0 };
+
+    for (int j = 0; j < tile->height + 2*halo; j++) {
+        pixel_t *row = buf + (size_t)j * tile->stride;
+        int sy = border_index(tile->y - halo + j, src->height, tiling->border);
+        if (sy < 0) {
+            for (int i = 0; i < tile->stride; i++) row[i] = black;
+            continue;
+        }
+        pixel_t *line = src->pix2d[sy];
+        memcpy(row + inside_first, line + x0 + inside_first, sizeof(pixel_t) * (inside_last - inside_first));
+        for (int i = 0; i < inside_first; i++) {
+            int sx = border_index(x0 + i, src->width, tiling->border);
+            row[i] = sx < 0 ? black : line[sx];
+        }
+        for (int i = inside_last; i < tile->stride; i++) {
+            int sx = border_index(x0 + i, src->width, tiling->border);
+            row[i] = sx < 0 ? black : line[sx];
+        }
+    }
+    tile->window = buf + (size_t)halo * tile->stride + halo;
+}
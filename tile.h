@@ -0,0 +1,60 @@
+/**
+ * @file tile.h
+ * @date 16 Oct 2026
+ * @brief Parallel execution of kernels over 2D tiles, with halo and border handling.
+ */
+
+#ifndef TILE_H
+#define TILE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "ppm.h"
+
+// Tile width and height used when 0 is given
+#define DEFAULT_TILE_SIZE 128
+
+// How pixels outside of the image are made up
+enum BORDER_MODE {
+    BORDER_CLAMP,   // repeat the edge pixel: aaa|abcd|ddd
+    BORDER_MIRROR,  // reflect around the edge pixel: dcb|abcd|cba
+    BORDER_ZERO     // black: 000|abcd|000
+};
+
+/**
+ * Tile handed to a tile kernel.
+ * @param x the left coordinate of the tile in the image
+ * @param y the top coordinate of the tile in the image
+ * @param width the width of the tile
+ * @param height the height of the tile
+ * @param halo the number of pixels available around the tile in the window
+ * @param stride the number of pixels between two rows of the window
+ * @param window copy of the source pixels of the tile and its halo, pointing to the pixel
+ *        at (x, y): window[j*stride + i] is valid for -halo <= i < width+halo and
+ *        -halo <= j < height+halo; NULL if no source image was given
+ * @param scratch memory private to the thread running the kernel, of the size given to
+ *        for_each_tile_scratch and reused from tile to tile (not cleared); NULL if none
+ */
+typedef struct {
+    int x, y;
+    int width, height;
+    int halo;
+    int stride;
+    const pixel_t *window;
+    void *scratch;
+} tile_t;
+
+/**
+ * Kernel processing a tile.
+ * @param arg the argument given to for_each_tile
+ * @param tile the tile to process
+ */
+typedef void (*tile_kernel_t)(void *arg, const tile_t *tile);
+
+extern int border_index(int i, int n, enum BORDER_MODE border);
+extern bool for_each_tile(img_t *src, int width, int height, int tile_width, int tile_height, int halo,
+                          enum BORDER_MODE border, tile_kernel_t kernel, void *arg);
+extern bool for_each_tile_scratch(img_t *src, int width, int height, int tile_width, int tile_height, int halo,
+                                  enum BORDER_MODE border, size_t scratch_bytes, tile_kernel_t kernel, void *arg);
+
+#endif
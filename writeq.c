@@ -0,0 +1,206 @@
+/**
+ * @file writeq.c
+ * @date 16 Oct 2026
+ * @brief Write-behind queue serializing PPM images on a background thread.
+ *
+ * The producer hands images over to the queue (ownership is transferred, no copy is made)
+ * and returns immediately. A single writer thread writes the frames in submission order
+ * and frees them afterwards. The amount of pixel data held by the queue is bounded by a
+ * memory budget: once the budget is exhausted, enqueue_ppm blocks until enough frames
+ * have been written (backpressure).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "writeq.h"
+
+typedef struct writeq_frame_st {
+    long seq;
+    char *filename;
+    img_t *img;
+    enum PPM_TYPE type;
+    size_t size;        // bytes accounted against the budget
+    struct writeq_frame_st *next;
+} writeq_frame_t;
+
+struct writeq_st {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;   // signaled when a frame is queued or the queue is closing
+    pthread_cond_t not_full;    // signaled when budget is released
+    pthread_cond_t drained;     // signaled when no frame is pending anymore
+    writeq_frame_t *head, *tail;
+    size_t budget;
+    size_t used;        // bytes held by queued and in-flight frames
+    int pending;        // number of queued and in-flight frames
+    int failed;         // number of frames which failed since the last flush
+    long next_seq;
+    bool closing;
+    writeq_done_t done;
+    void *done_arg;
+};
+
+static void *writer_thread(void *arg);
+static void drain(writeq_t *q);
+
+/**
+ * Create a write-behind queue and start its writer thread.
+ * @param budget maximum number of pixel bytes the queue may hold; a single frame larger
+ *        than the budget is still accepted, but only once the queue is empty
+ * @param done optional callback (may be NULL) invoked from the writer thread for each frame
+ * @param arg user argument passed to the callback
+ * @return a pointer to the queue or NULL if the allocation failed
+ */
+writeq_t *alloc_writeq(size_t budget, writeq_done_t done, void *arg) {
+    writeq_t *q = calloc(1, sizeof(writeq_t));
+    if (!q) return NULL;
+
+    q->budget = budget;
+    q->done = done;
+    q->done_arg = arg;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    pthread_cond_init(&q->drained, NULL);
+
+    if (pthread_create(&q->thread, NULL, writer_thread, q) != 0) {
+        pthread_cond_destroy(&q->drained);
+        pthread_cond_destroy(&q->not_full);
+        pthread_cond_destroy(&q->not_empty);
+        pthread_mutex_destroy(&q->lock);
+        free(q);
+        return NULL;
+    }
+    return q;
+}
+
+/**
+ * Hand an image over to the queue to be written as a PPM file.
+ * Blocks while the queue's memory budget is exhausted.
+ * On success, the queue takes ownership of the image and frees it once written:
+ * the caller must not access it anymore. On failure, the caller keeps ownership.
+ * @param q the queue
+ * @param filename (absolute or relative path) of the image to write; the string is copied
+ * @param img a pointer to the image to write
+ * @param PPM_TYPE the type of the image to write (binary or ASCII)
+ * @return the frame's sequence number (>= 0) or -1 if an error occured
+ */
+long enqueue_ppm(writeq_t *q, char *filename, img_t *img, enum PPM_TYPE type) {
+    writeq_frame_t *frame = malloc(sizeof(writeq_frame_t));
+    if (!frame) return -1;
+    frame->filename = strdup(filename);
+    if (!frame->filename) {
+        free(frame);
+        return -1;
+    }
+    frame->img = img;
+    frame->type = type;
+    frame->size = sizeof(pixel_t) * img->width * img->height;
+    frame->next = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (!q->closing && q->used > 0 && q->used + frame->size > q->budget)
+        pthread_cond_wait(&q->not_full, &q->lock);
+    if (q->closing) {
+        pthread_mutex_unlock(&q->lock);
+        free(frame->filename);
+        free(frame);
+        return -1;
+    }
+
+    frame->seq = q->next_seq++;
+    if (q->tail)
+        q->tail->next = frame;
+    else
+        q->head = frame;
+    q->tail = frame;
+    q->used += frame->size;
+    q->pending++;
+    long seq = frame->seq;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return seq;
+}
+
+/**
+ * Wait until every frame enqueued so far has been written.
+ * @param q the queue
+ * @return true if all frames written since the last flush succeeded, false otherwise
+ */
+bool flush_writeq(writeq_t *q) {
+    pthread_mutex_lock(&q->lock);
+    drain(q);
+    bool ok = q->failed == 0;
+    q->failed = 0;
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+/**
+ * Write all remaining frames, stop the writer thread and free the queue.
+ * @param q the queue to free
+ * @return true if all frames written since the last flush succeeded, false otherwise
+ */
+bool free_writeq(writeq_t *q) {
+    pthread_mutex_lock(&q->lock);
+    drain(q);
+    bool ok = q->failed == 0;
+    q->closing = true;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+
+    pthread_join(q->thread, NULL);
+    pthread_cond_destroy(&q->drained);
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->lock);
+    free(q);
+    return ok;
+}
+
+// ====================================================================================================
+// Private functions
+// ====================================================================================================
+
+// Wait (with the lock held) until no frame is pending.
+static void drain(writeq_t *q) {
+    while (q->pending > 0)
+        pthread_cond_wait(&q->drained, &q->lock);
+}
+
+// Pop frames in submission order and write them until the queue is closed.
+static void *writer_thread(void *arg) {
+    writeq_t *q = arg;
+
+    pthread_mutex_lock(&q->lock);
+    while (1) {
+        while (!q->head && !q->closing)
+            pthread_cond_wait(&q->not_empty, &q->lock);
+        if (!q->head) break;
+
+        writeq_frame_t *frame = q->head;
+        q->head = frame->next;
+        if (!q->head) q->tail = NULL;
+        pthread_mutex_unlock(&q->lock);
+
+        // The lock isn't held while writing so that producers can keep enqueuing
+        bool ok = write_ppm(frame->filename, frame->img, frame->type);
+        if (q->done)
+            q->done(frame->seq, frame->filename, ok, q->done_arg);
+        free_img(frame->img);
+        free(frame->filename);
+
+        pthread_mutex_lock(&q->lock);
+        q->used -= frame->size;
+        q->pending--;
+        if (!ok) q->failed++;
+        free(frame);
+        pthread_cond_broadcast(&q->not_full);
+        if (q->pending == 0)
+            pthread_cond_broadcast(&q->drained);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file writeq.h
+ * @date 16 Oct 2026
+ * @brief Write-behind queue serializing PPM images on a background thread.
+ */
+
+#ifndef WRITEQ_H
+#define WRITEQ_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "ppm.h"
+
+/**
+ * Opaque write-behind queue.
+ */
+typedef struct writeq_st writeq_t;
+
+/**
+ * Callback invoked by the writer thread once a frame has been written (or failed).
+ * @param seq the sequence number returned by enqueue_ppm for this frame
+ * @param filename the file the frame was written to
+ * @param ok whether the write succeeded or not
+ * @param arg the user argument given to alloc_writeq
+ */
+typedef void (*writeq_done_t)(long seq, const char *filename, bool ok, void *arg);
+
+extern writeq_t *alloc_writeq(size_t budget, writeq_done_t done, void *arg);
+extern long enqueue_ppm(writeq_t *q, char *filename, img_t *img, enum PPM_TYPE type);
+extern bool flush_writeq(writeq_t *q);
+extern bool free_writeq(writeq_t *q);
+
+#endif